@@ -2,30 +2,299 @@
 #include "order_book.h"
 #include "l2_book.h"
 #include "message.h"
+#include "reorder_buffer.h"
+#include "spsc_ring.h"
+#include <chrono>
 #include <map>
 #include <cstdint>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
 
 namespace OrderBook {
 
+/*
+ * Virtual listener interface, the fallback for listeners only known at runtime
+ * Use BookManager<OrderEventListener> with an implementation of this interface
+ */
+class OrderEventListener {
+public:
+  virtual ~OrderEventListener() = default;
+
+  virtual void onOrderAdd(SmartOrderBook& book, const OrderInfo& info) = 0;
+  virtual void onOrderCancel(SmartOrderBook& book, const OrderInfo& info) = 0;
+  virtual void onOrderModify(SmartOrderBook& book, const OrderInfo& info) = 0;
+  virtual void onOrderExecution(SmartOrderBook& book, const OrderInfo& info) = 0;
+};
+
+/*
+ * Event sink calling the listener as the book emits each event, nothing is buffered
+ * The event type is a constant at each emission site, so the switch folds away once the call is inlined
+ */
+template <typename Listener>
+struct ListenerSink {
+  Listener& listener;
+  SmartOrderBook& book;
+
+  void onEvent(const OrderInfo& info) {
+    switch (info.event) {
+      case OrderEvent::ADD:
+        listener.onOrderAdd(book, info);
+        break;
+      case OrderEvent::CANCEL:
+        listener.onOrderCancel(book, info);
+        break;
+      case OrderEvent::EXEC:
+        listener.onOrderExecution(book, info);
+        break;
+      case OrderEvent::MODIF:
+        listener.onOrderModify(book, info);
+        break;
+      default:
+        std::cerr << "Invalid order event type" << std::endl;
+        break;
+    }
+  }
+};
+
+/*
+ * Feed the messages to the book of their instrument and deliver the guessed order events to the listener
+ *
+ * There is one book per instrument id, see SymbolDirectory. Each book is built with the config of its instrument
+ * and a message is routed to its book by indexing with its instrument id
+ * A message with an instrument id out of range, e.g. from a corrupt packet, is dropped and counted
+ *
+ * The listener is a template parameter, any type with onOrderAdd, onOrderCancel, onOrderModify and onOrderExecution
+ * taking (SmartOrderBook&, const OrderInfo&). The calls are resolved at compile time and can be inlined
+ * With a reorder window, the messages given to ingest are merged in timestamp order first, see ReorderBuffer
+ * The book calls the listener through a ListenerSink as it emits each event, once the book is updated for it
+ * The listener may read the book but must not modify it
+ */
+template <typename Listener = OrderEventListener>
 class BookManager {
 public:
-  explicit BookManager();
-  ~BookManager() = default;
+  /*
+   * reorder_window is in nanoseconds of exchange time, 0 processes the messages in arrival order
+   * All the books use kSmallBookConfig, which preallocates little so that thousands of instruments fit.
+   * The books grow on demand, use the per instrument configs to size the busy instruments up front
+   */
+  explicit BookManager(Listener& listener, std::size_t num_instruments = 1, Timestamp reorder_window = 0)
+    : BookManager(listener, std::vector<BookConfig>(num_instruments, kSmallBookConfig), reorder_window) {}
 
-  void processOrderMessage(OrderMessage msg);
-  void processTradeMessage(TradeMessage msg);
-  void processSnapshotMessage(SnapshotMessage msg);
+  /*
+   * One book per config, the config of an instrument is at its instrument id
+   * Size the capacities of the books for their instruments, the default BookConfig preallocates for a busy instrument
+   */
+  BookManager(Listener& listener, const std::vector<BookConfig>& configs, Timestamp reorder_window = 0)
+    : listener_(listener), reorder_buffer_(reorder_window) {
+    // The books are built in place in one array, routing a message is a single index
+    books_ = std::allocator<SmartOrderBook>().allocate(configs.size());
+    allocated_books_ = configs.size();
+    try {
+      for (const auto& config: configs) {
+        new (books_ + num_books_) SmartOrderBook(config);
+        ++num_books_;
+      }
+    } catch (...) {
+      destroyBooks();
+      throw;
+    }
+  }
+  ~BookManager() { destroyBooks(); }
 
-  void flushEvents();
+  BookManager(const BookManager& rhs) = delete;
+  BookManager(BookManager&& rhs) = delete;
+  BookManager& operator=(const BookManager& rhs) = delete;
+  BookManager& operator=(BookManager&& rhs) = delete;
 
-  void onOrderAdd(SmartOrderBook& book, const OrderInfo& info);
-  void onOrderCancel(SmartOrderBook& book, const OrderInfo& info);
-  void onOrderModify(SmartOrderBook& book, const OrderInfo& info);
-  void onOrderExecution(SmartOrderBook& book, const OrderInfo& info);
+  void processOrderMessage(const OrderMessage& msg);
+  void processTradeMessage(const TradeMessage& msg);
+  void processSnapshotMessage(const SnapshotMessage& msg);
+  /*
+   * The snapshot view is processed in place
+   * The view is parsed from wire bytes, so a truncated view or one of an out of range instrument is dropped and counted
+   */
+  void processSnapshotMessage(const SnapshotView& msg);
+  void processMessage(const BookMessage& msg);
+
+  /*
+   * Process the messages of one packet, bypassing the reorder buffer
+   * The messages held in the reorder buffer are released first, so a batch is never processed before older messages
+   * given to ingest. Mixing the two entry points still gives up the reordering of the held messages with the batch
+   * Each run of consecutive messages of the same instrument is one batch of its book, see SmartOrderBook::processBatch
+   */
+  void processBatch(Span<const BookMessage> msgs);
+
+  // Process the message through the reorder buffer, it's processed once it's out of the reorder window
+  void ingest(BookMessage msg);
+  // Process all the messages held in the reorder buffer, at the end of the feed
+  void flushReorderBuffer();
+
+  /*
+   * Ingest a batch of at most max_batch messages from the ring, return the number of messages taken
+   * Called on the book thread, the ring is fed by the decoder thread
+   */
+  auto drain(SpscRing<BookMessage>& ring, std::size_t max_batch = kDefaultBatch) -> std::size_t;
+
+  /*
+   * Ingest the messages from the ring until it's closed and drained, waiting with the wait mode of the ring
+   * When the ring stays empty for the reorder window in wall clock time, the held messages are released,
+   * so the last messages of an idle feed don't wait for the next one. The reorder buffer is flushed at the end
+   */
+  void run(SpscRing<BookMessage>& ring);
+
+  auto numInstruments() const -> std::size_t { return num_books_; }
+  // Number of messages dropped because their instrument id is out of range, e.g. kUnknownInstrument,
+  // or because their snapshot view is truncated
+  auto droppedMessageCount() const -> std::size_t { return dropped_message_count_; }
+
+  // Assume the instrument id is valid
+  auto book(InstrumentId instrument = 0) -> SmartOrderBook& { return books_[instrument]; }
 
 private:
-  SmartOrderBook book_;  // The uncrossed L3 book
-  std::vector<OrderInfo> events_;
+  static constexpr std::size_t kDefaultBatch = 64;
+
+  // Return nullptr and count the messages as dropped if the instrument id is out of range
+  auto bookOf(InstrumentId instrument, std::size_t num_msgs = 1) -> SmartOrderBook* {
+    if (instrument >= num_books_) {
+      dropped_message_count_ += num_msgs;
+      return nullptr;
+    }
+    return &books_[instrument];
+  }
+
+  void destroyBooks() {
+    while (num_books_ > 0) {
+      books_[--num_books_].~SmartOrderBook();
+    }
+    if (books_ != nullptr) std::allocator<SmartOrderBook>().deallocate(books_, allocated_books_);
+    books_ = nullptr;
+  }
+
+  Listener& listener_;
+  // The uncrossed L3 books indexed by instrument id, constructed in place in one allocation
+  SmartOrderBook* books_{nullptr};
+  std::size_t num_books_{0};
+  std::size_t allocated_books_{0};
+  ReorderBuffer reorder_buffer_;
+  std::size_t dropped_message_count_{0};
 };
 
-} //namespace OrderBook
\ No newline at end of file
+template <typename Listener>
+void BookManager<Listener>::processOrderMessage(const OrderMessage& msg) {
+  auto book = bookOf(msg.instrument);
+  if (book == nullptr) return;
+  ListenerSink<Listener> sink{listener_, *book};
+  book->processOrderMessage(msg, sink);
+}
+
+template <typename Listener>
+void BookManager<Listener>::processMessage(const BookMessage& msg) {
+  auto book = bookOf(instrumentOf(msg));
+  if (book == nullptr) return;
+  ListenerSink<Listener> sink{listener_, *book};
+  book->processMessage(msg, sink);
+}
+
+template <typename Listener>
+void BookManager<Listener>::processBatch(Span<const BookMessage> msgs) {
+  flushReorderBuffer();
+  std::size_t first = 0;
+  while (first < msgs.size()) {
+    auto instrument = instrumentOf(msgs[first]);
+    auto last = first + 1;
+    while (last < msgs.size() && instrumentOf(msgs[last]) == instrument) ++last;
+    auto book = bookOf(instrument, last - first);
+    if (book != nullptr) {
+      ListenerSink<Listener> sink{listener_, *book};
+      book->processBatch(msgs.subspan(first, last - first), sink);
+    }
+    first = last;
+  }
+}
+
+template <typename Listener>
+auto BookManager<Listener>::drain(SpscRing<BookMessage>& ring, std::size_t max_batch) -> std::size_t {
+  return ring.consume([this](BookMessage& msg) { ingest(std::move(msg)); }, max_batch);
+}
+
+template <typename Listener>
+void BookManager<Listener>::run(SpscRing<BookMessage>& ring) {
+  bool idle = false;
+  std::chrono::steady_clock::time_point idle_since;
+  while (true) {
+    // Check closed before draining, so the messages pushed before close are processed
+    bool closed = ring.closed();
+    if (drain(ring) > 0) {
+      idle = false;
+      continue;
+    }
+    if (closed) break;
+    if (!reorder_buffer_.empty()) {
+      auto now = std::chrono::steady_clock::now();
+      if (!idle) {
+        idle = true;
+        idle_since = now;
+      }
+      // Don't block while messages are held, the lagging stream may still deliver within the window
+      if (now - idle_since < std::chrono::nanoseconds(reorder_buffer_.window())) {
+        std::this_thread::yield();
+        continue;
+      }
+      flushReorderBuffer();
+    }
+    idle = false;
+    ring.waitForData();
+  }
+  flushReorderBuffer();
+}
+
+template <typename Listener>
+void BookManager<Listener>::ingest(BookMessage msg) {
+  if (reorder_buffer_.window() == 0) {
+    processMessage(msg);
+    return;
+  }
+  reorder_buffer_.push(std::move(msg), [this](const BookMessage& released) { processMessage(released); });
+}
+
+template <typename Listener>
+void BookManager<Listener>::flushReorderBuffer() {
+  reorder_buffer_.flush([this](const BookMessage& released) { processMessage(released); });
+}
+
+template <typename Listener>
+void BookManager<Listener>::processSnapshotMessage(const SnapshotMessage& msg) {
+  auto book = bookOf(msg.instrument);
+  if (book == nullptr) return;
+  ListenerSink<Listener> sink{listener_, *book};
+  book->processSnapshotMessage(msg, sink);
+}
+
+template <typename Listener>
+void BookManager<Listener>::processSnapshotMessage(const SnapshotView& msg) {
+  if (!msg.valid()) {
+    ++dropped_message_count_;
+    return;
+  }
+  // The instrument id comes from the wire, it's never trusted
+  auto book = bookOf(msg.instrument());
+  if (book == nullptr) return;
+  ListenerSink<Listener> sink{listener_, *book};
+  book->processSnapshotMessage(msg, sink);
+}
+
+template <typename Listener>
+void BookManager<Listener>::processTradeMessage(const TradeMessage& msg) {
+  auto book = bookOf(msg.instrument);
+  if (book == nullptr) return;
+  ListenerSink<Listener> sink{listener_, *book};
+  book->processTradeMessage(msg, sink);
+}
+
+// The virtual fallback is compiled once in the library
+extern template class BookManager<OrderEventListener>;
+
+} //namespace OrderBook
@@ -1,14 +1,86 @@
 #pragma once
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <map>
+#include <unordered_map>
 #include <vector>
+#include "l2_book.h"
 #include "level.h"
+#include "order_pool.h"
+#include "price_ladder.h"
+#include "snapshot_ring.h"
+#include "snapshot_view.h"
 #include "trade.h"
 
 namespace OrderBook {
 
+/*
+ * Initial capacities of a book, sized for the activity of its instrument
+ * The order pools, the order map and the price ladders grow on demand past them, the snapshot rings don't
+ */
+struct BookCapacity {
+  // Orders of each side, the order map of the book is sized for both sides
+  size_t orders{1024};
+  // Slots of the price ladder of each side, and the largest window of the ladder
+  size_t price_levels{256};
+  size_t max_price_levels{65536};
+  // Expected snapshots queued on each side, the oldest one is overwritten when the ring is full
+  size_t expected_snapshots{1024};
+};
+
+// Capacities of a book when the activity of its instrument is unknown, small enough for thousands of books
+inline constexpr BookCapacity kSmallBookCapacity{64, 32, 65536, 64};
+
+// The L3 levels of one side are kept in a dense price ladder unless ORDERBOOK_PRICE_LADDER is turned off
+#ifdef ORDERBOOK_PRICE_LADDER
+template <typename Comparator>
+using L3SideBook = PriceLadder<L3PriceLevel, Comparator>;
+
+template <typename Comparator>
+auto makeL3SideBook(const BookCapacity& capacity) -> L3SideBook<Comparator> {
+  return L3SideBook<Comparator>(Comparator(), capacity.price_levels, capacity.max_price_levels);
+}
+#else
+template <typename Comparator>
+using L3SideBook = OneSideBook<L3PriceLevel, Comparator>;
+
+template <typename Comparator>
+auto makeL3SideBook(const BookCapacity&) -> L3SideBook<Comparator> {
+  return L3SideBook<Comparator>(Comparator());
+}
+#endif
+
+/*
+ * When the expected L2 snapshots are recorded
+ * PER_FILL: the book side records one after every fill and removed order
+ * PER_MESSAGE: the order book records at most one per side at the end of each processed message,
+ *   for venues publishing one L2 snapshot per inbound order event
+ */
+enum class SnapshotMode {
+  PER_FILL,
+  PER_MESSAGE
+};
+
+/*
+ * One side of the L3 book, specialized on the side tag Bid or Ask
+ * The side comparator is inlined and the side branches are resolved at compile time
+ */
+template <typename Side>
 class BookSide {
 public:
-  BookSide(const bool is_sell, PriceComparator comp);
+  using Comparator = typename Side::Comparator;
+
+  /*
+   * snapshot_depth is the number of levels published in the L2 snapshots of the venue, 0 means the full side
+   * Expected snapshots and reconciliation are then limited to the top snapshot_depth levels
+   * With shared_orders, the orders are indexed in the order map of the book shared by both sides,
+   * otherwise the side has its own
+   * With l2_book, the quantity changes of the levels are applied to it as they happen
+   */
+  explicit BookSide(SnapshotMode snapshot_mode = SnapshotMode::PER_FILL, size_t snapshot_depth = 0,
+                    OrderMap* shared_orders = nullptr, L2Book* l2_book = nullptr,
+                    const BookCapacity& capacity = BookCapacity());
   ~BookSide() = default;
 
   BookSide(const BookSide& rhs) = delete;
@@ -24,41 +96,77 @@ public:
   auto cend() const { return levels_.cend(); }
 
   bool existOrder(OrderId id) const {
-    return order_map_.find(id) != order_map_.end();
+    auto handler = order_map_.find(id);
+    return handler != nullptr && handler->order->is_sell == is_sell_;
   }
 
   // Assume the order exist
   auto getOrderHandler(OrderId id) -> const OrderHandler& {
-    return order_map_[id];
+    return *order_map_.find(id);
+  }
+
+  // Return nullptr if the order doesn't exist on this side
+  auto findOrder(OrderId id) -> OrderHandler* {
+    auto handler = order_map_.find(id);
+    return handler != nullptr && handler->order->is_sell == is_sell_ ? handler : nullptr;
   }
 
   /*
    * Add an order to current order book, assume this order won't make the order book crossed and can be added
+   * The book side keeps its own copy of the order, allocated from the order pool
+   * Return false if the id is already used on either side, the order is then not added
    */
-  void addOrder(const OrderPtr& order);
+  bool addOrder(const Order& order);
 
   /*
    * Remove an order from current order book
    * Will use it to handle order cancellation
+   * Like modifyOrder, an id of an order of the other side in the shared order map is ignored
    */
   void removeOrder(OrderId id);
 
   /*
    * Modify the order with new qty and price
    * Assume that the side of the order cannot be changed
+   * The order keeps its place in the queue without price change, otherwise it's moved to the back of the new level
+   * Neither case allocates
+   */
+  void modifyOrder(OrderId odid, const Quantity quantity, const Tick price);
+
+  // Set the original quantity of the order in place, the order keeps its place in the queue
+  void resizeOrder(OrderHandler& handler, const Quantity quantity);
+
+  /*
+   * Take the order out of its level, it stays in the order map and keeps its storage
+   * The order can then be repriced and put back with linkOrder, or given back with destroyUnlinkedOrder
    */
-  void modifyOrder(OrderId odid, const Quantity quantity, const Price price);
+  void unlinkOrder(OrderHandler& handler);
+
+  /*
+   * Create the order in a handler just inserted with findOrInsert on the order map, it isn't on a level yet
+   * The order is then put in the book with linkOrder, or given back with destroyUnlinkedOrder
+   */
+  void createUnlinkedOrder(OrderHandler& handler, const Order& order) {
+    assert(order.is_sell == is_sell_);
+    handler = {order_pool_.create(order), nullptr};
+  }
+
+  // Queue the unlinked order at the back of the level of its price, assume it won't make the book crossed
+  void linkOrder(OrderHandler& handler);
+
+  // Erase the unlinked order from the order map and give it back to the pool
+  void destroyUnlinkedOrder(OrderHandler* handler);
 
   // Check whether current order book side will be crossed with new order on the other book side
-  bool bookCrossedWithPrice(const Price price) const;
+  bool bookCrossedWithPrice(const Tick price) const;
 
   // Check whether an price level exists
-  bool existLevel(const Price price) const {
+  bool existLevel(const Tick price) const {
     return levels_.find(price) != levels_.end();
   }
 
   // Assume the level exist, need to be used with existLevel
-  auto getL3Level(const Price price) -> L3PriceLevel& {
+  auto getL3Level(const Tick price) -> L3PriceLevel& {
     return levels_[price];
   }
 
@@ -66,14 +174,33 @@ public:
    * Process the opposite aggreive order that will cross with current book side
    * Uncross the order book and add pending_liq_remove_qty_ since incoming trades are expected
    * Also update the quantity of the order
+   * The events are emitted to sink, see emitEvent. The overloads returning a vector are thin wrappers
+   * An event is emitted once the side is updated, so a sink reading the side sees the state after the event
    */
-  auto processCrossedOrder(const OrderPtr& order) -> OrderInfoVec;
+  template <typename Sink>
+  void processCrossedOrder(Order& order, Sink& sink);
+  auto processCrossedOrder(Order& order) -> OrderInfoVec {
+    OrderInfoVec order_events;
+    processCrossedOrder(order, order_events);
+    return order_events;
+  }
 
 
   /*
    * Need to match with pending liq remove qty
+   * cancelOrder takes the handler already found in the order map, nullptr if the order doesn't exist
    */
-  auto processOrderCancel(OrderId id, const Quantity quantity, const Price price) -> OrderInfoVec;
+  template <typename Sink>
+  void cancelOrder(OrderHandler* handler, const Quantity quantity, const Tick price, Sink& sink);
+  template <typename Sink>
+  void processOrderCancel(OrderId id, const Quantity quantity, const Tick price, Sink& sink) {
+    cancelOrder(findOrder(id), quantity, price, sink);
+  }
+  auto processOrderCancel(OrderId id, const Quantity quantity, const Tick price) -> OrderInfoVec {
+    OrderInfoVec order_events;
+    processOrderCancel(id, quantity, price, order_events);
+    return order_events;
+  }
 
   /*
    * Process trade message received. Trade is liquidity removing event.
@@ -82,48 +209,190 @@ public:
    * If there is still remaining qty, try to match with current levels and remove correspnding qty
    * If there is still remaining qty up to now, some liquidity adding events are expected. Then add the qty to pending_liq_add_qty_
    */
-  auto processTrade(const Trade& trade) -> OrderInfoVec;
+  template <typename Sink>
+  void processTrade(const Trade& trade, Sink& sink);
+  auto processTrade(const Trade& trade) -> OrderInfoVec {
+    OrderInfoVec order_events;
+    processTrade(trade, order_events);
+    return order_events;
+  }
 
   /*
    * Process the L2 snapshot on this side
+   * A lagging snapshot skips forward to its expected snapshot, the older expected snapshots are dropped
+   * With a snapshot depth, the levels worse than the published window are not touched
    * When liquidity is removed, will guess order cancellation and execution events based on 30% filled ratio
    */
-  auto processL2Snapshot(const L2SnapshotSide& side) -> OrderInfoVec;
+  template <typename Sink>
+  void processL2Snapshot(const L2SnapshotSide& side, Sink& sink) {
+    reconcileL2Snapshot(side, sink);
+  }
+  auto processL2Snapshot(const L2SnapshotSide& side) -> OrderInfoVec {
+    OrderInfoVec order_events;
+    processL2Snapshot(side, order_events);
+    return order_events;
+  }
+
+  // Same as above on the side of a snapshot still in the wire buffer
+  template <typename Sink>
+  void processL2Snapshot(const L2SnapshotView& side, Sink& sink) {
+    reconcileL2Snapshot(side, sink);
+  }
+  auto processL2Snapshot(const L2SnapshotView& side) -> OrderInfoVec {
+    OrderInfoVec order_events;
+    processL2Snapshot(side, order_events);
+    return order_events;
+  }
 
   /*
    * Matched with the pending liq adding qty and return the matched quantity
    */
-  auto matchPendingLiqAdd(const Quantity quantity, const Price price) -> Quantity;
+  auto matchPendingLiqAdd(const Quantity quantity, const Tick price) -> Quantity;
 
   /*
    * Matched with the pending liq removing qty and return the matched quantity
    */
-  auto matchPendingLiqRemove(const Quantity quantity, const Price price) -> Quantity;
+  auto matchPendingLiqRemove(const Quantity quantity, const Tick price) -> Quantity;
 
   /*
-   * Add the pending liq removing qty
+   * Expect the trade of an execution at the price, e.g. a fill of an aggressive order of this side
    */
-  void addPendingLiqRemoveQty(const OrderInfoVec& events);
+  void addPendingLiqRemoveQty(const Tick price, const Quantity quantity) {
+    pending_liq_remove_qty_[price] += quantity;
+  }
 
+  // Queue the fingerprint of current side, the matching L2 snapshot is expected later
   void saveL2SnapshoSide();
 
-  friend std::ostream& operator<<(std::ostream& os, const BookSide& side);
+  /*
+   * Inside a batch, saving the expected snapshot only marks it as pending
+   * The pending snapshot is queued once at the end of the batch or before processing an L2 snapshot,
+   * so the side records at most one expected snapshot between two sync points
+   */
+  void beginBatch() { in_batch_ = true; }
+  void endBatch() {
+    in_batch_ = false;
+    savePendingSnapshot();
+  }
+
+  auto snapshotMode() const -> SnapshotMode { return snapshot_mode_; }
+
+  // Number of expected snapshots overwritten in the full ring or skipped as stale
+  auto droppedSnapshots() const -> size_t { return l2_snap_queue_.dropped(); }
+
+  // Best level of the side, cached and only refreshed when the touch changes
+  auto best() const -> const L2PriceLevel& { return best_; }
+
+  /*
+   * Copy the best non empty levels into levels, at most n and levels.size()
+   * Return the number of levels copied, nothing is allocated
+   */
+  auto topLevels(size_t n, Span<L2PriceLevel> levels) const -> size_t;
+
+  // Fingerprint of the current (price, qty) state, maintained incrementally
+  auto fingerprint() const -> L2Fingerprint { return fingerprint_; }
+
+  // Fingerprint of the top snapshot depth levels, the one of the full side without snapshot depth
+  auto windowFingerprint() const -> L2Fingerprint;
+
+  auto snapshotDepth() const -> size_t { return snapshot_depth_; }
+
+  auto orderPool() const -> const OrderPool& { return order_pool_; }
+  auto expectedSnapshotCapacity() const -> size_t { return l2_snap_queue_.capacity(); }
+
+  // Print the levels with the tick size of the instrument, from the worst ask or the best bid
+  void print(std::ostream& os, const TickSize& tick_size) const;
+
+  friend std::ostream& operator<<(std::ostream& os, const BookSide& side) {
+    side.print(os, kDefaultTickSize);
+    return os;
+  }
 
 private:
-  const bool is_sell_;
-  const PriceComparator comp_;
-  OneSideBook<L3PriceLevel, PriceComparator> levels_;
-  OrderMap order_map_;
+  // Unlink the order from its level and give it back to the pool, the handler is already erased from order_map_
+  void releaseOrder(const OrderHandler& handler);
+
+  // Erase an order of this side from the order map and release it, the id is probed once
+  void releaseLevelOrder(const Order* order) {
+    OrderHandler removed{};
+    order_map_.findAndErase(order->odid, removed);
+    releaseOrder(removed);
+  }
+
+  // Update the fingerprint, the L2 view and the touch after the quantity of the level changed from old_qty
+  void levelChanged(const L3PriceLevel& level, const Quantity old_qty) {
+    fingerprint_ ^= levelFingerprint(level.price, old_qty) ^ levelFingerprint(level.price, level.quantity);
+    if (l2_book_ != nullptr && level.quantity != old_qty) l2_book_->setLevel(is_sell_, level.price, level.quantity);
+    // Only a level at or better than the touch can change it
+    if (best_.quantity == 0 || !comp_(best_.price, level.price)) refreshBest();
+  }
+
+  // The level emptied by the last change may still be in levels_, so the empty levels are skipped
+  void refreshBest();
+
+  // Record the expected snapshot after a fill or a removed order, only in PER_FILL mode
+  void saveFillSnapshot() {
+    if (snapshot_mode_ == SnapshotMode::PER_FILL) saveL2SnapshoSide();
+  }
+
+  // Queue the expected snapshot marked as pending in the batch
+  void savePendingSnapshot() {
+    if (!snapshot_pending_) return;
+    snapshot_pending_ = false;
+    l2_snap_queue_.push_back(windowFingerprint());
+  }
+
+  // Fill the order on its level and keep the fingerprint in sync
+  void fillOrder(L3PriceLevel& level, Order& order, const Quantity qty);
+
+  // Levels is L2SnapshotSide or L2SnapshotView, both are iterated as a range of L2 levels
+  template <typename Levels, typename Sink>
+  void reconcileL2Snapshot(const Levels& side, Sink& sink);
+
+  // Emit the events of the level once its filled orders are removed
+  template <typename Sink>
+  void emitLevelEvents(Sink& sink) {
+    for (const auto& info: level_events_) {
+      emitEvent(sink, info);
+    }
+  }
+
+  // Full compare of the snapshot with the current levels in the window, the empty levels are ignored
+  template <typename Levels>
+  bool sameLevels(const Levels& side) const;
+
+  static constexpr bool is_sell_ = Side::is_sell;
+  const Comparator comp_{};
+  OrderPool order_pool_;
+  L3SideBook<Comparator> levels_;
+  OrderMap own_orders_;
+  // Either own_orders_ or the order map shared with the other side
+  OrderMap& order_map_;
+
+  L2Fingerprint fingerprint_{0};
+  L2PriceLevel best_;
+  L2Book* l2_book_;
+  SnapshotMode snapshot_mode_;
+  size_t snapshot_depth_;
 
   /*
-   * Will save a L2SnapshotSide when the order book status changes
+   * Will save the fingerprint of the side when the order book status changes
    */
-  L2SnapshotSideQue l2_snap_queue_;
+  SnapshotRing l2_snap_queue_;
+  bool in_batch_{false};
+  bool snapshot_pending_{false};
+
+  // Scratch buffers of the snapshot reconciliation, reused so that a snapshot doesn't allocate
+  std::vector<std::pair<Order*, Quantity>> pending_orders_;
+  std::vector<Tick> snapshot_prices_;
+  // Scratch buffers of the events and the removed orders of the level being filled
+  OrderInfoVec level_events_;
+  std::vector<Order*> level_orders_;
 
   /* Store the pending qty for liquidity removing events
    * Liquidity remove events includes trades and cancellation. They can be matched with precise price
    */
-  std::unordered_map<Price, Quantity> pending_liq_remove_qty_;
+  std::unordered_map<Tick, Quantity> pending_liq_remove_qty_;
 
   /* Store the pending qty for liquidity adding events
    * Liquidity add events cannot be matched with precise price
@@ -138,7 +407,251 @@ private:
    * So a map is used to store the pending qty. The comparator is the same as levels
    * Any incoming order event that can beat the map top will match the top quantity
    */
-  std::map<Price, Quantity, PriceComparator> pending_liq_add_qty_{comp_};
+  OneSideBook<Quantity, Comparator> pending_liq_add_qty_;
 };
 
+/*
+ * With the assumption that messages in order steam come in order
+ * Then book crosses, the crossed orders are expected to be filled
+ * No need to guess here.
+ *
+ * The code logic can also handle the case that order meesages arrive out of order
+ * only need to add the guess logic
+ */
+template <typename Side>
+template <typename Sink>
+void BookSide<Side>::processCrossedOrder(Order& order, Sink& sink) {
+  // Need to pass the aggressor
+  assert(order.is_sell != is_sell_);
+  Quantity remaining_quantity = order.getRemainingQuantity();
+  while (remaining_quantity > 0 && bookCrossedWithPrice(order.price)) {
+    auto& cur_level = levels_.begin()->second;
+    level_orders_.clear();
+    level_events_.clear();
+    for (auto& cur_order: cur_level.orders) {
+      if (remaining_quantity == 0) break;
+      Quantity fillable_qty = std::min(remaining_quantity, cur_order.getRemainingQuantity());
+      fillOrder(cur_level, cur_order, fillable_qty);
+      saveFillSnapshot();
+      remaining_quantity -= fillable_qty;
+      if (cur_order.getRemainingQuantity() == 0) {
+        level_orders_.push_back(&cur_order);
+      }
+      level_events_.emplace_back(OrderEvent::EXEC, cur_order.odid, is_sell_, fillable_qty, cur_order.price);
+      // Expect trade messages will be received
+      // Trade is liquidity remove event so incease pending liq remove qty
+      pending_liq_remove_qty_[cur_order.price] += fillable_qty;
+      order.filled_quantity += fillable_qty;
+    }
+    for (auto filled: level_orders_) {
+      releaseLevelOrder(filled);
+    }
+    emitLevelEvents(sink);
+  }
+}
+
+template <typename Side>
+template <typename Sink>
+void BookSide<Side>::cancelOrder(OrderHandler* handler, const Quantity quantity, const Tick price, Sink& sink) {
+  Quantity rest_qty = quantity - matchPendingLiqRemove(quantity, price);
+  // If still have qty to cancel then should cancel order in order book
+  if (rest_qty > 0 && handler != nullptr) {
+    auto cancelled = *handler;
+    order_map_.erase(handler);
+    OrderInfo info(OrderEvent::CANCEL, cancelled.order->odid, is_sell_, rest_qty, price);
+    releaseOrder(cancelled);
+    emitEvent(sink, info);
+  }
+}
+
+template <typename Side>
+template <typename Sink>
+void BookSide<Side>::processTrade(const Trade& trade, Sink& sink) {
+  // If there is still pending liq remote qty for this trade price
+  auto cur_trade_qty = trade.quantity;
+  cur_trade_qty -= matchPendingLiqRemove(trade.quantity, trade.price);
+
+  /* If still have trade qty to match, try to match the qty in current limits and update the order book
+   * Considering an ask side
+   *   Ask
+   *  50@102
+   *  40@101  <==  Received a trade 10@101
+   *  30@100
+   *
+   *  Steps to handle it
+   *  1. Cancel all orders below the price level (above the price leve for bid side)
+   *  2. Match the trade with corresponding level
+   *  3. Add pending liq add qty for remaining trade qty
+   */
+
+  // Step 1
+  while(!levels_.empty()) {
+    auto iter = levels_.begin();
+    bool should_cancel = comp_(iter->first, trade.price);
+    if (!should_cancel) break;
+    level_orders_.clear();
+    level_events_.clear();
+    for (auto& order: iter->second.orders) {
+      level_orders_.push_back(&order);
+      level_events_.emplace_back(OrderEvent::CANCEL, order.odid, is_sell_, order.quantity, order.price);
+    }
+    for (auto removed: level_orders_) {
+      releaseLevelOrder(removed);
+      saveFillSnapshot();
+    }
+    emitLevelEvents(sink);
+  }
+
+  // Step 2
+  if (existLevel(trade.price)) {
+    auto& cur_level = getL3Level(trade.price);
+    level_orders_.clear();
+    level_events_.clear();
+    for (auto& cur_order: cur_level.orders) {
+      if (cur_trade_qty == 0) break;
+      Quantity fillable_qty = std::min(cur_trade_qty, cur_order.getRemainingQuantity());
+      fillOrder(cur_level, cur_order, fillable_qty);
+      saveFillSnapshot();
+      cur_trade_qty -= fillable_qty;
+      if (cur_order.getRemainingQuantity() == 0) {
+        level_orders_.push_back(&cur_order);
+      }
+      level_events_.emplace_back(OrderEvent::EXEC, cur_order.odid, is_sell_, fillable_qty, cur_order.price);
+    }
+    for (auto removed: level_orders_) {
+      releaseLevelOrder(removed);
+      saveFillSnapshot();
+    }
+    emitLevelEvents(sink);
+  }
+
+  // Step 3
+  if (cur_trade_qty > 0) {
+    pending_liq_add_qty_[trade.price] += cur_trade_qty;
+    // Guess that there will be a incoming new order,
+    // since the odid is assigned by exchange so we are not sure what's the order id, will just use -1
+    emitEvent(sink, OrderInfo(OrderEvent::ADD, -1, is_sell_, cur_trade_qty, trade.price));
+    emitEvent(sink, OrderInfo(OrderEvent::EXEC, -1, is_sell_, cur_trade_qty, trade.price));
+  }
+}
+
+template <typename Side>
+template <typename Levels, typename Sink>
+void BookSide<Side>::reconcileL2Snapshot(const Levels& side, Sink& sink) {
+  // The snapshot may be the one expected for the state reached so far in the batch
+  savePendingSnapshot();
+  auto snapshot_fingerprint = l2Fingerprint(side);
+  auto pos = l2_snap_queue_.find(snapshot_fingerprint);
+  // Only the current state is still available to confirm the fingerprint with a full compare
+  if (pos != l2_snap_queue_.size() && (snapshot_fingerprint != windowFingerprint() || sameLevels(side))) {
+    // received the expected l2 snapshot, the expected snapshots before it are stale
+    l2_snap_queue_.skip(pos);
+    l2_snap_queue_.pop_front();
+    return;
+  }
+
+  // Use this to generate fake order id, the fake ids in use on either side are skipped
+  OrderId fake_order_id = kFirstFakeOrderId;
+  auto next_fake_order_id = [this, &fake_order_id]() {
+    while (order_map_.contains(fake_order_id)) --fake_order_id;
+    return fake_order_id--;
+  };
+  if (l2_snap_queue_.empty()) {
+    // L2 lead the order and trade steam, then the l2_snap_queue_ should be empty
+    // No need to save l2 snapshot in this case
+    pending_orders_.clear();
+    snapshot_prices_.clear();
+    // A full snapshot with depth only publishes the levels up to its worst price
+    size_t snapshot_levels = 0;
+    Tick window_worst = 0;
+    for (const auto l2_level: side) {
+      if (l2_level.quantity == 0) continue;
+      if (snapshot_levels++ == 0 || comp_(window_worst, l2_level.price)) window_worst = l2_level.price;
+    }
+    bool limited_window = snapshot_depth_ != 0 && snapshot_levels >= snapshot_depth_;
+    for (const auto l2_level: side) {
+      snapshot_prices_.push_back(l2_level.price);
+      if (existLevel(l2_level.price)) {
+        if (l2_level.quantity < levels_[l2_level.price].quantity) {
+          // Expect liquidity removing events
+          // Remove order from the front of list to match the qty
+          Quantity qty_to_remove = levels_[l2_level.price].quantity - l2_level.quantity;
+          for (auto& order: levels_[l2_level.price].orders) {
+            if (qty_to_remove == 0) break;
+            Quantity cur_remove_quantity = std::min(qty_to_remove, order.getRemainingQuantity());
+            qty_to_remove -= cur_remove_quantity;
+            pending_orders_.emplace_back(&order, cur_remove_quantity);
+          }
+        } else if (l2_level.quantity > levels_[l2_level.price].quantity) {
+          // Expect liquidity adding events
+          Quantity cur_qty = l2_level.quantity - levels_[l2_level.price].quantity;
+          pending_liq_add_qty_[l2_level.price] += cur_qty;
+          addOrder(Order(next_fake_order_id(), is_sell_, cur_qty, l2_level.price));
+          emitEvent(sink, OrderInfo(OrderEvent::ADD, -1, is_sell_, cur_qty, l2_level.price));
+        }
+      } else {
+        // Expect liquidity adding events
+        // Simply use one large order. Can improve here
+        pending_liq_add_qty_[l2_level.price] += l2_level.quantity;
+        addOrder(Order(next_fake_order_id(), is_sell_, l2_level.quantity, l2_level.price));
+        emitEvent(sink, OrderInfo(OrderEvent::ADD, -1, is_sell_, l2_level.quantity, l2_level.price));
+      }
+    }
+
+    // The snapshot is normally sorted already, sorting keeps the lookup correct if it's not
+    std::sort(snapshot_prices_.begin(), snapshot_prices_.end());
+    for (auto& [price, level]: levels_) {
+      // The levels out of the window are not published
+      if (limited_window && comp_(window_worst, price)) break;
+      // Check the level that is in current book but not in l2 snapshot
+      if (!std::binary_search(snapshot_prices_.begin(), snapshot_prices_.end(), price)) {
+        // Expect liquidity remove events
+        for (auto& order: level.orders) {
+          pending_orders_.emplace_back(&order, order.getRemainingQuantity());
+        }
+      }
+    }
+
+    // 30% of liqidity removing events will be order execution, the reset will be order cancellation
+    // The top 30% of the pending order sorted by descending order on ask side and ascending order in bid side
+    auto executed_order_num = ceil(0.3 * pending_orders_.size());
+    for (size_t i = 0; i < pending_orders_.size(); ++i) {
+      auto& [order, qty] = pending_orders_[i];
+      OrderInfo info(i < executed_order_num ? OrderEvent::EXEC : OrderEvent::CANCEL, order->odid, is_sell_, qty,
+                     order->price);
+      if (order->getRemainingQuantity() == qty) {
+        removeOrder(order->odid);
+      } else {
+        if (existLevel(order->price)) {
+          fillOrder(levels_[order->price], *order, qty);
+        }
+      }
+      emitEvent(sink, info);
+    }
+    return;
+  }
+  // Error case, receive an polluted snapshot
+}
+
+template <typename Side>
+template <typename Levels>
+bool BookSide<Side>::sameLevels(const Levels& side) const {
+  size_t book_levels = 0;
+  Tick window_worst = 0;
+  for (const auto& [price, level]: levels_) {
+    if (level.quantity == 0) continue;
+    window_worst = price;
+    if (++book_levels == snapshot_depth_) break;
+  }
+  size_t snapshot_levels = 0;
+  for (const auto l2_level: side) {
+    if (l2_level.quantity == 0) continue;
+    ++snapshot_levels;
+    auto iter = levels_.find(l2_level.price);
+    if (iter == levels_.end() || iter->second.quantity != l2_level.quantity) return false;
+    if (comp_(window_worst, l2_level.price)) return false;
+  }
+  return snapshot_levels == book_levels;
+}
+
 } //namespace OrderBook
\ No newline at end of file
@@ -1,35 +1,87 @@
 #pragma once
-#include <common.h>
-#include <functional>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <map>
+#include <type_traits>
+#include <vector>
+#include "pool_allocator.h"
 
 namespace OrderBook {
 
 using Quantity = int;
+// Venue price, only used at the decode and output boundary
 using Price = double;
+// Integer price in number of ticks, all the book internals work on ticks
+using Tick = std::int64_t;
 using OrderId = int;
-using PriceComparator = std::function<bool(const Price&, const Price&)>;
+// The venue order ids are non-negative, -1 is the id of the guessed orders in the events
+// The fake orders of the snapshot reconciliation count down from kFirstFakeOrderId, so they never collide with them
+inline constexpr OrderId kFirstFakeOrderId = -2;
+// Dense index of an instrument, given by the SymbolDirectory
+using InstrumentId = std::uint32_t;
+inline constexpr InstrumentId kUnknownInstrument = UINT32_MAX;
+// Exchange timestamp in nanoseconds
+using Timestamp = std::uint64_t;
+
+/*
+ * Tick size of an instrument
+ * Decoders convert the venue price to ticks once, and ticks are converted back to price only for output
+ */
+struct TickSize {
+  Price size;
+  explicit TickSize(Price tick_size = 0.01) : size(tick_size) {}
+
+  [[nodiscard]] Tick toTick(const Price price) const {
+    return std::llround(price / size);
+  }
+
+  [[nodiscard]] Price toPrice(const Tick tick) const {
+    return static_cast<Price>(tick) * size;
+  }
+};
+
+// Used by the stream operators of orders and levels which don't know their instrument
+inline const TickSize kDefaultTickSize{};
 
 struct BidComparator {
-  bool operator()(const Price& lhs, const Price& rhs) const {
+  constexpr bool operator()(const Tick& lhs, const Tick& rhs) const {
     return lhs > rhs;
   }
 };
 
 struct AskComparator {
-  bool operator()(const Price& lhs, const Price& rhs) const {
+  constexpr bool operator()(const Tick& lhs, const Tick& rhs) const {
     return lhs < rhs;
   }
 };
 
-//template <typename LevelType, typename Comparator>
-//using BookItermAllocator = PoolAllocator<typename std::map<Price, LevelType, Comparator>::value_type>;
-//
-//template <typename LevelType, typename Comparator>
-//using OneSideBook = std::map<Price, LevelType, Comparator, BookItermAllocator<LevelType, Comparator>>;
+// Side tags, the book side is specialized on them at compile time
+struct Bid {
+  using Comparator = BidComparator;
+  static constexpr bool is_sell = false;
+};
+
+struct Ask {
+  using Comparator = AskComparator;
+  static constexpr bool is_sell = true;
+};
+
+// The nodes of the book maps come from a pool unless ORDERBOOK_POOL_ALLOCATOR is turned off
+#ifdef ORDERBOOK_POOL_ALLOCATOR
+template <typename T>
+using BookAllocator = PoolAllocator<T>;
+#else
+template <typename T>
+using BookAllocator = std::allocator<T>;
+#endif
+
+template <typename LevelType, typename Comparator>
+using BookItermAllocator = BookAllocator<typename std::map<Tick, LevelType, Comparator>::value_type>;
 
 template <typename LevelType, typename Comparator>
-using OneSideBook = std::map<Price, LevelType, Comparator>;
+using OneSideBook = std::map<Tick, LevelType, Comparator, BookItermAllocator<LevelType, Comparator>>;
 
 enum class OrderEvent {
   ADD,
@@ -43,8 +95,8 @@ struct OrderInfo {
   OrderId odid;
   bool is_sell;
   Quantity quantity;
-  Price price;
-  OrderInfo(OrderEvent e, OrderId id, bool sell, Quantity qty, Price p) : event(e), odid(id), is_sell(sell), quantity(qty), price(p) {}
+  Tick price;
+  OrderInfo(OrderEvent e, OrderId id, bool sell, Quantity qty, Tick p) : event(e), odid(id), is_sell(sell), quantity(qty), price(p) {}
   bool operator==(const OrderInfo& rhs) const {
     return event == rhs.event && odid == rhs.odid && quantity == rhs.quantity && price == rhs.price;
   }
@@ -52,6 +104,54 @@ struct OrderInfo {
 
 using OrderInfoVec = std::vector<OrderInfo>;
 
+/*
+ * The book emits its events to a sink as they happen
+ * An OrderInfoVec sink appends them, any other sink is called inline with onEvent(const OrderInfo&)
+ */
+inline void emitEvent(OrderInfoVec& events, const OrderInfo& info) {
+  events.push_back(info);
+}
+
+template <typename Sink>
+void emitEvent(Sink& sink, const OrderInfo& info) {
+  sink.onEvent(info);
+}
+
+// Sink dropping the events
+struct NullSink {
+  void onEvent(const OrderInfo&) {}
+};
+
+/*
+ * View of contiguous elements, a minimal std::span until the code moves to C++20
+ * Span<const T> is read only, Span<T> lets the callee fill caller owned storage
+ */
+template <typename T>
+class Span {
+public:
+  constexpr Span() = default;
+  constexpr Span(T* data, std::size_t size) : data_(data), size_(size) {}
+  // Any contiguous container, e.g. std::vector, std::array or a Span of non const elements
+  template <typename Container, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Container>, Span>>>
+  constexpr Span(Container&& container) : data_(std::data(container)), size_(std::size(container)) {}
+
+  constexpr auto data() const -> T* { return data_; }
+  constexpr auto begin() const -> T* { return data_; }
+  constexpr auto end() const -> T* { return data_ + size_; }
+  constexpr auto size() const -> std::size_t { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  constexpr auto operator[](std::size_t idx) const -> T& { return data_[idx]; }
+
+  // Assume offset + count <= size()
+  constexpr auto subspan(std::size_t offset, std::size_t count) const -> Span {
+    return Span(data_ + offset, count);
+  }
+
+private:
+  T* data_{nullptr};
+  std::size_t size_{0};
+};
+
 // Merge events of b into a
 inline void mergeEvents(OrderInfoVec& a, OrderInfoVec b) {
   a.reserve(a.size() + b.size());
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "level.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace OrderBook {
+
+/*
+ * Flat L2 side used as an alternative to std::map for the sides of the L2 book
+ *
+ * The levels are kept in a contiguous array sorted from the best to the worst level, with the prices mirrored
+ * in their own array. An L2 book is at most a few dozen levels deep, so the position of a price is found by
+ * counting the levels better than it with a vectorized compare over the price array, 4 prices per AVX2 compare
+ * A scalar binary search is used when the code is not built with AVX2
+ * Inserting and removing a level move the worse levels by one slot
+ *
+ * Iteration goes from the best level to the worst level and yields the L2 levels
+ * The comparator is only used to know the direction of the side at compile time
+ */
+template <typename Comparator>
+class FlatL2Side {
+public:
+  using key_compare = Comparator;
+  using value_type = L2PriceLevel;
+  using size_type = std::size_t;
+  using iterator = typename std::vector<L2PriceLevel>::iterator;
+  using const_iterator = typename std::vector<L2PriceLevel>::const_iterator;
+  using reverse_iterator = typename std::vector<L2PriceLevel>::reverse_iterator;
+  using const_reverse_iterator = typename std::vector<L2PriceLevel>::const_reverse_iterator;
+
+  explicit FlatL2Side(size_type capacity = kDefaultCapacity) {
+    prices_.reserve(capacity);
+    levels_.reserve(capacity);
+  }
+
+  auto begin() -> iterator { return levels_.begin(); }
+  auto end() -> iterator { return levels_.end(); }
+  auto begin() const -> const_iterator { return levels_.begin(); }
+  auto end() const -> const_iterator { return levels_.end(); }
+  auto rbegin() -> reverse_iterator { return levels_.rbegin(); }
+  auto rend() -> reverse_iterator { return levels_.rend(); }
+  auto rbegin() const -> const_reverse_iterator { return levels_.rbegin(); }
+  auto rend() const -> const_reverse_iterator { return levels_.rend(); }
+
+  bool empty() const { return levels_.empty(); }
+  auto size() const -> size_type { return levels_.size(); }
+
+  auto find(const Tick price) -> iterator {
+    auto pos = position(price);
+    return found(pos, price) ? levels_.begin() + pos : levels_.end();
+  }
+
+  auto find(const Tick price) const -> const_iterator {
+    auto pos = position(price);
+    return found(pos, price) ? levels_.begin() + pos : levels_.end();
+  }
+
+  auto count(const Tick price) const -> size_type {
+    return found(position(price), price) ? 1 : 0;
+  }
+
+  // Get the level at the price, insert an empty level if it doesn't exist
+  auto operator[](const Tick price) -> L2PriceLevel& {
+    auto pos = position(price);
+    if (!found(pos, price)) {
+      prices_.insert(prices_.begin() + pos, price);
+      levels_.insert(levels_.begin() + pos, L2PriceLevel(price, 0));
+    }
+    return levels_[pos];
+  }
+
+  auto erase(const Tick price) -> size_type {
+    auto pos = position(price);
+    if (!found(pos, price)) return 0;
+    prices_.erase(prices_.begin() + pos);
+    levels_.erase(levels_.begin() + pos);
+    return 1;
+  }
+
+  void clear() {
+    prices_.clear();
+    levels_.clear();
+  }
+
+private:
+  static constexpr bool kDescending = Comparator()(1, 0);
+  static constexpr size_type kDefaultCapacity = 64;
+
+  bool found(const size_type pos, const Tick price) const {
+    return pos < prices_.size() && prices_[pos] == price;
+  }
+
+  // Number of levels better than the price, which is the position of the price in the side
+  auto position(const Tick price) const -> size_type {
+    const Tick* prices = prices_.data();
+    const size_type size = prices_.size();
+#if defined(__AVX2__)
+    size_type better = 0;
+    size_type idx = 0;
+    const __m256i target = _mm256_set1_epi64x(price);
+    for (; idx + 4 <= size; idx += 4) {
+      auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(prices + idx));
+      auto mask = kDescending ? _mm256_cmpgt_epi64(block, target) : _mm256_cmpgt_epi64(target, block);
+      auto bits = static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(mask)));
+      better += static_cast<size_type>(__builtin_popcount(bits));
+      // The side is sorted, a block with a level not better than the price ends the better levels
+      if (bits != 0xF) return better;
+    }
+    for (; idx < size && comp_(prices[idx], price); ++idx) {
+      ++better;
+    }
+    return better;
+#else
+    size_type low = 0;
+    size_type high = size;
+    while (low < high) {
+      auto mid = low + (high - low) / 2;
+      if (comp_(prices[mid], price)) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+#endif
+  }
+
+  // Static so that the side stays copy assignable
+  static constexpr Comparator comp_{};
+  std::vector<Tick> prices_;
+  std::vector<L2PriceLevel> levels_;
+};
+
+} // namespace OrderBook
\ No newline at end of file
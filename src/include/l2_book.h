@@ -1,15 +1,53 @@
 #pragma once
+#include <cstdint>
+#include "flat_l2_side.h"
 #include "level.h"
 #include "trade.h"
 
 namespace OrderBook {
 
+// The sides of the L2 book are flat sorted arrays unless ORDERBOOK_FLAT_L2 is turned off
+#ifdef ORDERBOOK_FLAT_L2
+template <typename Comparator>
+using L2SideBook = FlatL2Side<Comparator>;
+#else
+template <typename Comparator>
+using L2SideBook = OneSideBook<L2PriceLevel, Comparator>;
+#endif
 
+// The level of an entry of either side representation
+inline auto levelOf(const L2PriceLevel& level) -> const L2PriceLevel& { return level; }
+inline auto levelOf(const std::pair<const Tick, L2PriceLevel>& entry) -> const L2PriceLevel& { return entry.second; }
+
+enum class L2DeltaType {
+  ADD,
+  UPDATE,
+  REMOVE
+};
+
+// Change of one L2 level, the quantity is the new quantity of the level and unused for a removal
+struct L2Delta {
+  L2DeltaType type;
+  bool is_sell;
+  Tick price;
+  Quantity quantity;
+  bool operator==(const L2Delta& rhs) const {
+    return type == rhs.type && is_sell == rhs.is_sell && price == rhs.price && quantity == rhs.quantity;
+  }
+};
+
+using L2DeltaVec = std::vector<L2Delta>;
+
+/*
+ * L2 view of a book
+ * SmartOrderBook keeps one up to date as its L3 levels change, see setLevel
+ * The version is bumped by every change, so a reader can tell whether the book changed since its last read
+ */
 class L2Book {
 public:
-  explicit L2Book() = default;
-  L2Book(OneSideBook<L2PriceLevel, BidComparator> bids, OneSideBook<L2PriceLevel, AskComparator> asks)
-    : bidBook_(std::move(bids)), askBook_(std::move(asks)) {}
+  explicit L2Book(TickSize tick_size = TickSize()) : tick_size_(tick_size) {}
+  L2Book(L2SideBook<BidComparator> bids, L2SideBook<AskComparator> asks, TickSize tick_size = TickSize())
+    : bidBook_(std::move(bids)), askBook_(std::move(asks)), tick_size_(tick_size) {}
   ~L2Book() = default;
   L2Book(const L2Book& rhs) = default;
   L2Book(L2Book&& rhs) = default;
@@ -17,17 +55,40 @@ public:
   L2Book& operator=(L2Book&& rhs) = default;
 
 
-  bool existLevel(const bool is_sell, const Price price) const;
+  bool existLevel(const bool is_sell, const Tick price) const;
   // Assume the level exist, need to be used with existLevel
-  auto getL2Level(const bool is_sell, const Price price) -> const L2PriceLevel&;
-  void addLevel(const bool is_sell, const Price price, const Quantity quantity);
-  void updateLevel(const bool is_sell, const Price price, const Quantity quantity);
-  void removeLevel(const bool is_sell, const Price price);
+  auto getL2Level(const bool is_sell, const Tick price) -> const L2PriceLevel&;
+  void addLevel(const bool is_sell, const Tick price, const Quantity quantity);
+  void updateLevel(const bool is_sell, const Tick price, const Quantity quantity);
+  void removeLevel(const bool is_sell, const Tick price);
+
+  // Set the quantity of the level with a single lookup, an empty level is removed
+  void setLevel(const bool is_sell, const Tick price, const Quantity quantity);
+
+  auto version() const -> std::uint64_t { return version_; }
+
+  /*
+   * Append to deltas the changes turning this book into target, asks first then bids, best level first
+   * Both sides are walked once in a merge of the two sorted sides
+   */
+  void diff(const L2Book& target, L2DeltaVec& deltas) const;
+
+  // Patch the book in place with the deltas of diff
+  void apply(Span<const L2Delta> deltas);
+
+  // Convert a tick back to the venue price, used at the output boundary
+  auto toPrice(const Tick tick) const -> Price {
+    return tick_size_.toPrice(tick);
+  }
+  auto tickSize() const -> const TickSize& { return tick_size_; }
+
   friend std::ostream& operator<<(std::ostream& os, const L2Book& book);
 
 private:
-  OneSideBook<L2PriceLevel, BidComparator> bidBook_;
-  OneSideBook<L2PriceLevel, AskComparator> askBook_;
+  L2SideBook<BidComparator> bidBook_;
+  L2SideBook<AskComparator> askBook_;
+  TickSize tick_size_;
+  std::uint64_t version_{0};
 };
 
 
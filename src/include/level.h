@@ -1,39 +1,73 @@
 #pragma once
-#include <deque>
 #include "common.h"
 #include "order.h"
 
 namespace OrderBook {
 
 struct L2PriceLevel {
-  Price price;
+  Tick price;
   Quantity quantity;
   L2PriceLevel(): price(0), quantity(0) {}
-  L2PriceLevel(Price p, Quantity q): price(p), quantity(q) {}
+  L2PriceLevel(Tick p, Quantity q): price(p), quantity(q) {}
   bool operator==(const L2PriceLevel& rhs) const {
     return price == rhs.price && quantity == rhs.quantity;
   }
 
+  // Print the level with the tick size of its instrument
+  void print(std::ostream& os, const TickSize& tick_size) const;
+
   friend std::ostream& operator<<(std::ostream& os, const L2PriceLevel& level);
 };
 
 using L2SnapshotSide = std::vector<L2PriceLevel>;
-using L2SnapshotSideQue = std::deque<L2SnapshotSide>;
+
+// Best bid and offer, the level of an empty side has a zero quantity
+struct Bbo {
+  L2PriceLevel bid;
+  L2PriceLevel ask;
+};
+
+/*
+ * 64-bit fingerprint of the (price, qty) state of one book side
+ * It's the XOR of the fingerprints of the levels, so it can be updated incrementally when a level changes
+ * and doesn't depend on the order of the levels
+ */
+using L2Fingerprint = std::uint64_t;
+
+// An empty level doesn't contribute to the fingerprint of the side
+inline auto levelFingerprint(const Tick price, const Quantity quantity) -> L2Fingerprint {
+  if (quantity == 0) return 0;
+  auto x = static_cast<std::uint64_t>(price) * 0x9E3779B97F4A7C15ULL ^ static_cast<std::uint32_t>(quantity);
+  // splitmix64 finalizer
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// Levels is any range of L2 levels, e.g. L2SnapshotSide or L2SnapshotView
+template <typename Levels>
+inline auto l2Fingerprint(const Levels& side) -> L2Fingerprint {
+  L2Fingerprint fingerprint = 0;
+  for (const auto& level: side) {
+    fingerprint ^= levelFingerprint(level.price, level.quantity);
+  }
+  return fingerprint;
+}
 
 
 struct L3PriceLevel {
-  Price price;
+  Tick price;
   Quantity quantity;
   int num_orders;
-  OrderList orders;
+  OrderQueue orders;
 
   L3PriceLevel(): price(0), quantity(0), num_orders(0), orders() {}
 
   // Assume that this order can be added to this limit. The sanity check should be done at book level
-  auto addOrder(const OrderPtr& order) -> OrderListIter;
+  void addOrder(Order* order);
 
-  // Assume that the order exist in the order list
-  void removeOrder(const OrderHandler& handler);
+  // Assume that the order exist in the order queue
+  void removeOrder(Order* order);
 
   /*
    * Assume the order exist, the existence check should be done at book level
@@ -41,16 +75,18 @@ struct L3PriceLevel {
    * The order modification that also changes price will be handled differently
    * Only modify the original quantity
    */
-  void modifyOrder(OrderPtr order, const Quantity new_quantity, const Price new_price);
+  void modifyOrder(Order& order, const Quantity new_quantity, const Tick new_price);
 
   // Fill the order with quantity, assume that the remaining qty is larger than the quantity to be filed
-  void fillOrder(OrderPtr order, Quantity qty);
+  void fillOrder(Order& order, Quantity qty);
 
   // Get the L2 level
   auto getL2Level() const -> L2PriceLevel {
     return {price, quantity};
   }
 
+  // Print the level and its orders with the tick size of its instrument
+  void print(std::ostream& os, const TickSize& tick_size) const;
 
   friend std::ostream& operator<<(std::ostream& os, const L3PriceLevel& level);
 };
@@ -1,10 +1,19 @@
 #pragma once
+#include <variant>
 #include "common.h"
 #include "order.h"
 #include "level.h"
+#include "trade.h"
 
 namespace OrderBook {
 
+/*
+ * All the prices in messages are in ticks
+ * Decoders convert the venue price with the TickSize of the instrument once
+ * The instrument is the dense id given by the SymbolDirectory, it defaults to 0 for a single instrument feed
+ * The timestamp is the exchange time, used to merge the three streams in order
+ */
+
 enum class MessageType {
   ADD,        // Add new order
   CANCEL,     // Cancel existing orders
@@ -19,17 +28,22 @@ struct OrderMessage {
   OrderId id;
   bool is_sell;
   Quantity quantity;
-  Price price;
+  Tick price;
+  InstrumentId instrument{0};
+  Timestamp timestamp{0};
 
-  [[nodiscard]] OrderPtr toOrder() const {
-    return std::make_shared<Order>(id, is_sell, quantity, price);
+  [[nodiscard]] Order toOrder() const {
+    return Order(id, is_sell, quantity, price);
   }
 };
 
 struct TradeMessage {
   Quantity quantity;
-  Price price;
-  TradeMessage(Quantity q, Price p): quantity(q), price(p) {}
+  Tick price;
+  InstrumentId instrument;
+  Timestamp timestamp;
+  TradeMessage(Quantity q, Tick p, InstrumentId i = 0, Timestamp t = 0)
+    : quantity(q), price(p), instrument(i), timestamp(t) {}
   [[nodiscard]] Trade toTrade() const {
     return{quantity, price};
   }
@@ -39,6 +53,19 @@ struct SnapshotMessage {
   // Assume bid and ask level in snapshot is already sorted with correct order
   L2SnapshotSide bid_levels;
   L2SnapshotSide ask_levels;
+  InstrumentId instrument{0};
+  Timestamp timestamp{0};
 };
 
+// Any message of the three streams, used where the messages are queued or routed together
+using BookMessage = std::variant<OrderMessage, TradeMessage, SnapshotMessage>;
+
+inline auto instrumentOf(const BookMessage& msg) -> InstrumentId {
+  return std::visit([](const auto& m) { return m.instrument; }, msg);
+}
+
+inline auto timestampOf(const BookMessage& msg) -> Timestamp {
+  return std::visit([](const auto& m) { return m.timestamp; }, msg);
+}
+
 } //namespace OrderBook
\ No newline at end of file
@@ -1,37 +1,137 @@
 #pragma once
 #include "common.h"
-#include <list>
-#include <memory>
-#include <unordered_map>
+#include <cstddef>
+#include <iterator>
 #include <iostream>
+#include "order_index.h"
 
 namespace OrderBook {
 
-struct Order {
+struct L3PriceLevel;
+
+// Aligned to a cache line so that cancelling or filling an order touches a single line
+struct alignas(64) Order {
   OrderId odid;
   bool is_sell;
   Quantity quantity;
-  Price price;
+  Tick price;
   Quantity filled_quantity;
-  explicit Order(OrderId id, bool is_sell, Quantity quantity, Price price)
-    : odid(id), is_sell(is_sell), quantity(quantity), price(price), filled_quantity(0) {}
+  // Links of the intrusive FIFO queue of the price level
+  Order* prev;
+  Order* next;
+  explicit Order(OrderId id, bool is_sell, Quantity quantity, Tick price)
+    : odid(id), is_sell(is_sell), quantity(quantity), price(price), filled_quantity(0), prev(nullptr), next(nullptr) {}
 
   [[nodiscard]] Quantity getRemainingQuantity() const {
     return quantity - filled_quantity;
   }
 
+  // Print the order with the tick size of its instrument
+  void print(std::ostream& os, const TickSize& tick_size) const;
+
   friend std::ostream& operator<<(std::ostream& os, const Order& order);
 };
 
-using OrderPtr = std::shared_ptr<Order>;
-using OrderList = std::list<OrderPtr>;
-using OrderListIter = std::list<OrderPtr>::iterator;
+/*
+ * Intrusive doubly-linked FIFO queue of orders with the links stored inside Order
+ * The queue doesn't own the orders, pushing and erasing an order never allocate
+ */
+class OrderQueue {
+public:
+  template <typename OrderType>
+  class Iter {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Order;
+    using difference_type = std::ptrdiff_t;
+    using pointer = OrderType*;
+    using reference = OrderType&;
+
+    explicit Iter(OrderType* order) : order_(order) {}
+    reference operator*() const { return *order_; }
+    pointer operator->() const { return order_; }
+    Iter& operator++() {
+      order_ = order_->next;
+      return *this;
+    }
+    Iter operator++(int) {
+      Iter tmp = *this;
+      order_ = order_->next;
+      return tmp;
+    }
+    bool operator==(const Iter& rhs) const { return order_ == rhs.order_; }
+    bool operator!=(const Iter& rhs) const { return order_ != rhs.order_; }
+
+  private:
+    OrderType* order_;
+  };
+
+  using iterator = Iter<Order>;
+  using const_iterator = Iter<const Order>;
+
+  OrderQueue() = default;
+  ~OrderQueue() = default;
+  OrderQueue(const OrderQueue& rhs) = delete;
+  OrderQueue& operator=(const OrderQueue& rhs) = delete;
+  OrderQueue(OrderQueue&& rhs) noexcept : head_(rhs.head_), tail_(rhs.tail_) {
+    rhs.head_ = rhs.tail_ = nullptr;
+  }
+  OrderQueue& operator=(OrderQueue&& rhs) noexcept {
+    head_ = rhs.head_;
+    tail_ = rhs.tail_;
+    rhs.head_ = rhs.tail_ = nullptr;
+    return *this;
+  }
+
+  auto begin() -> iterator { return iterator(head_); }
+  auto end() -> iterator { return iterator(nullptr); }
+  auto begin() const -> const_iterator { return const_iterator(head_); }
+  auto end() const -> const_iterator { return const_iterator(nullptr); }
+
+  bool empty() const { return head_ == nullptr; }
+  auto front() -> Order& { return *head_; }
+  auto back() -> Order& { return *tail_; }
+
+  void push_back(Order* order) {
+    order->prev = tail_;
+    order->next = nullptr;
+    if (tail_ != nullptr) {
+      tail_->next = order;
+    } else {
+      head_ = order;
+    }
+    tail_ = order;
+  }
+
+  // Assume the order is in this queue
+  void erase(Order* order) {
+    if (order->prev != nullptr) {
+      order->prev->next = order->next;
+    } else {
+      head_ = order->next;
+    }
+    if (order->next != nullptr) {
+      order->next->prev = order->prev;
+    } else {
+      tail_ = order->prev;
+    }
+    order->prev = order->next = nullptr;
+  }
+
+private:
+  Order* head_{nullptr};
+  Order* tail_{nullptr};
+};
 
+/*
+ * The order and the level it is queued at
+ * The order is owned by the book side
+ */
 struct OrderHandler {
-  OrderPtr order;
-  OrderListIter iter;
+  Order* order;
+  L3PriceLevel* level;
 };
 
-using OrderMap = std::unordered_map<OrderId, OrderHandler>;
+using OrderMap = OrderIndex<OrderHandler>;
 
 } // namespace OrderBook
\ No newline at end of file
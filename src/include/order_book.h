@@ -3,41 +3,375 @@
 #include "book_side.h"
 #include "l2_book.h"
 #include "message.h"
-#include <array>
+#include "snapshot_view.h"
 #include <algorithm>
+#include <iostream>
 #include <iterator>
 
 namespace OrderBook {
 
+// Configuration of the book of one instrument
+struct BookConfig {
+  TickSize tick_size{};
+  SnapshotMode snapshot_mode{SnapshotMode::PER_FILL};
+  // Number of levels per side in the L2 snapshots, 0 means the full book
+  size_t snapshot_depth{0};
+  BookCapacity capacity{};
+};
+
+// Default config of the books of a manager built without per instrument configs
+inline const BookConfig kSmallBookConfig{TickSize(), SnapshotMode::PER_FILL, 0, kSmallBookCapacity};
+
 class SmartOrderBook {
 public:
-  SmartOrderBook();
+  // snapshot_depth is the number of levels per side in the L2 snapshots, 0 means the full book
+  explicit SmartOrderBook(TickSize tick_size = TickSize(), SnapshotMode snapshot_mode = SnapshotMode::PER_FILL,
+                          size_t snapshot_depth = 0)
+    : SmartOrderBook(BookConfig{tick_size, snapshot_mode, snapshot_depth}) {}
+  explicit SmartOrderBook(const BookConfig& config);
   ~SmartOrderBook() = default;
-  SmartOrderBook(const BookSide& rhs) = delete;
-  SmartOrderBook(BookSide&& rhs) = delete;
+  SmartOrderBook(const SmartOrderBook& rhs) = delete;
+  SmartOrderBook(SmartOrderBook&& rhs) = delete;
   SmartOrderBook& operator=(const SmartOrderBook& rhs) = delete;
   SmartOrderBook& operator=(SmartOrderBook&& rhs) = delete;
 
-  auto processOrderAddMessage(const OrderMessage& msg) -> OrderInfoVec;
-  auto processOrderCancelMessage(const OrderMessage& msg) -> OrderInfoVec;
-  auto processOrderModifyMessage(const OrderMessage& msg) -> OrderInfoVec;
-  auto processTradeMessage(const TradeMessage& msg) -> OrderInfoVec;
-  auto processSnapshotMessage(const SnapshotMessage& msg) -> OrderInfoVec;
+  /*
+   * The events are emitted to the sink as they happen, see emitEvent
+   * An OrderInfoVec sink is a caller provided buffer, which can be reused across messages to avoid allocating
+   * for every message. Any other sink is called inline, e.g. BookManager calls its listener without buffering
+   * An event is emitted once the book is updated for it, the sink must not modify the book
+   */
+  template <typename Sink>
+  void processOrderAddMessage(const OrderMessage& msg, Sink& sink);
+  template <typename Sink>
+  void processOrderCancelMessage(const OrderMessage& msg, Sink& sink);
+  template <typename Sink>
+  void processOrderModifyMessage(const OrderMessage& msg, Sink& sink);
+  template <typename Sink>
+  void processTradeMessage(const TradeMessage& msg, Sink& sink);
+  template <typename Sink>
+  void processSnapshotMessage(const SnapshotMessage& msg, Sink& sink);
+  // Zero-copy overload on a snapshot still in the wire buffer, assume the view is valid
+  template <typename Sink>
+  void processSnapshotMessage(const SnapshotView& msg, Sink& sink);
+
+  // Dispatch the message on its type, the only place the message types are switched on
+  template <typename Sink>
+  void processOrderMessage(const OrderMessage& msg, Sink& sink);
+  template <typename Sink>
+  void processMessage(const BookMessage& msg, Sink& sink);
+
+  // Thin wrappers returning the events of one message
+  auto processOrderAddMessage(const OrderMessage& msg) -> OrderInfoVec {
+    OrderInfoVec events;
+    processOrderAddMessage(msg, events);
+    return events;
+  }
+  auto processOrderCancelMessage(const OrderMessage& msg) -> OrderInfoVec {
+    OrderInfoVec events;
+    processOrderCancelMessage(msg, events);
+    return events;
+  }
+  auto processOrderModifyMessage(const OrderMessage& msg) -> OrderInfoVec {
+    OrderInfoVec events;
+    processOrderModifyMessage(msg, events);
+    return events;
+  }
+  auto processTradeMessage(const TradeMessage& msg) -> OrderInfoVec {
+    OrderInfoVec events;
+    processTradeMessage(msg, events);
+    return events;
+  }
+  auto processSnapshotMessage(const SnapshotMessage& msg) -> OrderInfoVec {
+    OrderInfoVec events;
+    processSnapshotMessage(msg, events);
+    return events;
+  }
+  auto processSnapshotMessage(const SnapshotView& msg) -> OrderInfoVec {
+    OrderInfoVec events;
+    processSnapshotMessage(msg, events);
+    return events;
+  }
+
+  /*
+   * Process the messages of one packet in order, their instrument is not checked
+   * Within the batch each side records at most one expected snapshot, the state at the end of the batch
+   * or before a snapshot message. The venue snapshots of the intermediate states are then not matched,
+   * they are ignored while the one of the batch end is still expected
+   */
+  template <typename Sink>
+  void processBatch(Span<const BookMessage> msgs, Sink& sink);
+  auto processBatch(Span<const BookMessage> msgs) -> OrderInfoVec {
+    OrderInfoVec events;
+    processBatch(msgs, events);
+    return events;
+  }
 
-  auto getL2Book() -> L2Book;
+  /*
+   * The L2 view is maintained as the levels change, reading it is free
+   * The reference stays valid for the lifetime of the book, compare L2Book::version to detect a change
+   */
+  auto getL2Book() const -> const L2Book& { return l2_book_; }
 
+  // Print the L3 levels with the tick size of the instrument, the asks from the worst then the bids from the best
+  void printL3(std::ostream& os) const {
+    asks_.print(os, tick_size_);
+    bids_.print(os, tick_size_);
+  }
+
+  // Cached best bid and offer
+  auto bbo() const -> Bbo { return {bids_.best(), asks_.best()}; }
+
+  /*
+   * Copy the best n levels of one side into caller owned storage, best first
+   * Return the number of levels copied, bounded by levels.size(). Nothing is allocated
+   */
+  auto topLevels(bool is_sell, size_t n, Span<L2PriceLevel> levels) const -> size_t {
+    return is_sell ? asks_.topLevels(n, levels) : bids_.topLevels(n, levels);
+  }
+
+  // Decoders use the tick size to convert venue prices to ticks
+  auto tickSize() const -> const TickSize& { return tick_size_; }
+
+  auto snapshotMode() const -> SnapshotMode { return snapshot_mode_; }
+  auto snapshotDepth() const -> size_t { return bids_.snapshotDepth(); }
+
+  // The orders of both sides are in one order map, the side of an order is given by the order itself
   bool existOrder(OrderId id) const {
-    return sides_[0].existOrder(id) || sides_[1].existOrder(id);
+    return orders_.contains(id);
   }
 
+  // Assume the order exist
   auto getOrderHandler(OrderId id) -> const OrderHandler& {
-    if (sides_[0].existOrder(id)) return sides_[0].getOrderHandler(id);
-    return sides_[1].getOrderHandler(id);
+    return *orders_.find(id);
   }
 
+  // Number of order add messages dropped because their id is already in the book
+  auto duplicateOrderCount() const -> size_t { return duplicate_order_count_; }
+
 private:
-  // sides_[0] is bid side, side[1] is ask side
-  std::array<BookSide, 2> sides_;
+  // Forward the executions of an aggressive order, their trades are also expected on the side of the aggressor
+  template <typename Side, typename Sink>
+  struct AggressorSink {
+    BookSide<Side>& side;
+    Sink& sink;
+
+    void onEvent(const OrderInfo& info) {
+      if (info.event == OrderEvent::EXEC) side.addPendingLiqRemoveQty(info.price, info.quantity);
+      emitEvent(sink, info);
+    }
+  };
+
+  // Dispatch the order add message to its side, doesn't record the expected snapshot
+  template <typename Sink>
+  void addOrder(const OrderMessage& msg, Sink& sink);
+
+  /*
+   * Modify the order on its side without going through a cancel and an add
+   * A quantity down at the same price is done in place and keeps the queue position
+   * Otherwise the same order is moved to the back of its new level, after matching the pending liq add qty
+   * and uncrossing the book as a new order would
+   */
+  template <typename Side, typename OppositeSide>
+  void modifyOrder(BookSide<Side>& side, BookSide<OppositeSide>& opposite_side, OrderHandler* handler,
+                   const OrderMessage& msg);
+
+  // Find the order on the side of the message with one probe, nullptr if it's not there
+  auto findOrder(const OrderMessage& msg) -> OrderHandler* {
+    auto handler = orders_.find(msg.id);
+    return handler != nullptr && handler->order->is_sell == msg.is_sell ? handler : nullptr;
+  }
+
+  /*
+   * Process the order add message with the side of the order and the opposite side
+   * The handler is the slot of the new id, just inserted in the order map
+   */
+  template <typename Side, typename OppositeSide, typename Sink>
+  void processOrderAdd(BookSide<Side>& side, BookSide<OppositeSide>& opposite_side, OrderHandler* handler,
+                       const OrderMessage& msg, Sink& sink);
+
+  /*
+   * In PER_MESSAGE mode, record the expected snapshot of each side changed by the message
+   * The fingerprints are the ones of the sides before processing the message
+   */
+  void saveMessageSnapshot(L2Fingerprint bid_fingerprint, L2Fingerprint ask_fingerprint);
+
+  TickSize tick_size_;
+  SnapshotMode snapshot_mode_;
+  // Shared by both sides, so they are constructed before them
+  OrderMap orders_;
+  L2Book l2_book_;
+  BookSide<Bid> bids_;
+  BookSide<Ask> asks_;
+  size_t duplicate_order_count_{0};
 };
 
+/*
+ * Process incoming orders on this side
+ * If there is pending liq add qty at the order price level, match the pending qty first
+ * If there is remaining qty, check whether the order will make the order book crosed
+ * If tehre is remaining qty after uncrossing the book, add the order in current side
+ */
+template <typename Sink>
+void SmartOrderBook::processOrderAddMessage(const OrderMessage& msg, Sink& sink) {
+  auto bid_fingerprint = bids_.fingerprint();
+  auto ask_fingerprint = asks_.fingerprint();
+  addOrder(msg, sink);
+  saveMessageSnapshot(bid_fingerprint, ask_fingerprint);
+}
+
+template <typename Sink>
+void SmartOrderBook::addOrder(const OrderMessage& msg, Sink& sink) {
+  // One probe finds a duplicated id and reserves the slot of a new one
+  auto [handler, inserted] = orders_.findOrInsert(msg.id);
+  // A duplicated id is dropped before it can match or uncross, the order in the book is kept
+  if (!inserted) {
+    ++duplicate_order_count_;
+    return;
+  }
+  if (msg.is_sell) {
+    processOrderAdd(asks_, bids_, handler, msg, sink);
+  } else {
+    processOrderAdd(bids_, asks_, handler, msg, sink);
+  }
+}
+
+template <typename Side, typename OppositeSide, typename Sink>
+void SmartOrderBook::processOrderAdd(BookSide<Side>& side, BookSide<OppositeSide>& opposite_side,
+                                     OrderHandler* handler, const OrderMessage& msg, Sink& sink) {
+  side.createUnlinkedOrder(*handler, msg.toOrder());
+  auto& order = *handler->order;
+  order.filled_quantity += side.matchPendingLiqAdd(msg.quantity, msg.price);
+  // check whether it's crossed
+  if (order.getRemainingQuantity() > 0 && opposite_side.bookCrossedWithPrice(msg.price)) {
+    AggressorSink<Side, Sink> aggressor_sink{side, sink};
+    opposite_side.processCrossedOrder(order, aggressor_sink);
+    // The filled orders are erased from the shared order map, which moves the handlers
+    handler = orders_.find(msg.id);
+  }
+  if (order.getRemainingQuantity() == 0) {
+    side.destroyUnlinkedOrder(handler);
+    return;
+  }
+  side.linkOrder(*handler);
+  emitEvent(sink, OrderInfo(OrderEvent::ADD, msg.id, msg.is_sell, order.getRemainingQuantity(), order.price));
+}
+
+template <typename Sink>
+void SmartOrderBook::processOrderCancelMessage(const OrderMessage &msg, Sink& sink) {
+  auto bid_fingerprint = bids_.fingerprint();
+  auto ask_fingerprint = asks_.fingerprint();
+  auto handler = findOrder(msg);
+  if (msg.is_sell) {
+    asks_.cancelOrder(handler, msg.quantity, msg.price, sink);
+  } else {
+    bids_.cancelOrder(handler, msg.quantity, msg.price, sink);
+  }
+  saveMessageSnapshot(bid_fingerprint, ask_fingerprint);
+}
+
+template <typename Sink>
+void SmartOrderBook::processOrderModifyMessage(const OrderMessage& msg, Sink& sink) {
+  auto bid_fingerprint = bids_.fingerprint();
+  auto ask_fingerprint = asks_.fingerprint();
+  auto handler = findOrder(msg);
+  if (msg.is_sell) {
+    modifyOrder(asks_, bids_, handler, msg);
+  } else {
+    modifyOrder(bids_, asks_, handler, msg);
+  }
+  saveMessageSnapshot(bid_fingerprint, ask_fingerprint);
+  emitEvent(sink, OrderInfo(OrderEvent::MODIF, msg.id, msg.is_sell, msg.quantity, msg.price));
+}
+
+template <typename Side, typename OppositeSide>
+void SmartOrderBook::modifyOrder(BookSide<Side>& side, BookSide<OppositeSide>& opposite_side, OrderHandler* handler,
+                                 const OrderMessage& msg) {
+  if (handler == nullptr) return;
+  auto& order = *handler->order;
+  // There are some uncertain points here. When modifiy partially filled order, not sure whether the quantity received is new remaining qty or new original qty. Here will just assume it's new remaining qty.
+  if (msg.price == order.price && msg.quantity <= order.getRemainingQuantity()) {
+    side.resizeOrder(*handler, order.filled_quantity + msg.quantity);
+    return;
+  }
+  side.unlinkOrder(*handler);
+  order.price = msg.price;
+  order.quantity = order.filled_quantity + msg.quantity;
+  order.filled_quantity += side.matchPendingLiqAdd(msg.quantity, msg.price);
+  if (order.getRemainingQuantity() > 0 && opposite_side.bookCrossedWithPrice(msg.price)) {
+    // Only the modification event is reported, drop the executions of the uncross
+    NullSink dropped;
+    AggressorSink<Side, NullSink> aggressor_sink{side, dropped};
+    opposite_side.processCrossedOrder(order, aggressor_sink);
+    // The filled orders are erased from the shared order map, which moves the handlers
+    handler = orders_.find(msg.id);
+  }
+  if (order.getRemainingQuantity() == 0) {
+    side.destroyUnlinkedOrder(handler);
+  } else {
+    side.linkOrder(*handler);
+  }
+}
+
+template <typename Sink>
+void SmartOrderBook::processTradeMessage(const TradeMessage &msg, Sink& sink) {
+  auto bid_fingerprint = bids_.fingerprint();
+  auto ask_fingerprint = asks_.fingerprint();
+  bids_.processTrade(msg.toTrade(), sink);
+  asks_.processTrade(msg.toTrade(), sink);
+  saveMessageSnapshot(bid_fingerprint, ask_fingerprint);
+}
+
+template <typename Sink>
+void SmartOrderBook::processBatch(Span<const BookMessage> msgs, Sink& sink) {
+  bids_.beginBatch();
+  asks_.beginBatch();
+  for (const auto& msg: msgs) {
+    processMessage(msg, sink);
+  }
+  bids_.endBatch();
+  asks_.endBatch();
+}
+
+template <typename Sink>
+void SmartOrderBook::processOrderMessage(const OrderMessage& msg, Sink& sink) {
+  switch (msg.type) {
+    case MessageType::ADD:
+      processOrderAddMessage(msg, sink);
+      break;
+    case MessageType::CANCEL:
+      processOrderCancelMessage(msg, sink);
+      break;
+    case MessageType::MODIFY:
+      processOrderModifyMessage(msg, sink);
+      break;
+    default:
+      std::cerr << "Invalid order message type" << std::endl;
+      break;
+  }
+}
+
+template <typename Sink>
+void SmartOrderBook::processMessage(const BookMessage& msg, Sink& sink) {
+  if (auto order_msg = std::get_if<OrderMessage>(&msg)) {
+    processOrderMessage(*order_msg, sink);
+  } else if (auto trade_msg = std::get_if<TradeMessage>(&msg)) {
+    processTradeMessage(*trade_msg, sink);
+  } else {
+    processSnapshotMessage(std::get<SnapshotMessage>(msg), sink);
+  }
+}
+
+template <typename Sink>
+void SmartOrderBook::processSnapshotMessage(const SnapshotMessage &msg, Sink& sink) {
+  bids_.processL2Snapshot(msg.bid_levels, sink);
+  asks_.processL2Snapshot(msg.ask_levels, sink);
+}
+
+template <typename Sink>
+void SmartOrderBook::processSnapshotMessage(const SnapshotView& msg, Sink& sink) {
+  bids_.processL2Snapshot(msg.bidLevels(), sink);
+  asks_.processL2Snapshot(msg.askLevels(), sink);
+}
+
 } //namespace OrderBook
\ No newline at end of file
@@ -0,0 +1,194 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+namespace OrderBook {
+
+/*
+ * Flat open-addressing hash index from order id to a value stored inline
+ *
+ * Uses Robin Hood probing: an entry that is further from its home slot takes the place of a richer one,
+ * which keeps the probe sequences short. Deletion shifts the following entries back by one slot,
+ * so no tombstone is left behind and lookups never slow down after many cancels
+ *
+ * The pointers returned by find and findOrInsert are only valid until the next insertion or deletion
+ */
+template <typename Value>
+class OrderIndex {
+public:
+  explicit OrderIndex(std::size_t capacity = 16) {
+    rehash(capacity);
+  }
+  ~OrderIndex() = default;
+  OrderIndex(const OrderIndex& rhs) = default;
+  OrderIndex(OrderIndex&& rhs) noexcept = default;
+  OrderIndex& operator=(const OrderIndex& rhs) = default;
+  OrderIndex& operator=(OrderIndex&& rhs) noexcept = default;
+
+  auto size() const -> std::size_t { return size_; }
+  bool empty() const { return size_ == 0; }
+  auto capacity() const -> std::size_t { return slots_.size(); }
+
+  // Make sure that n entries can be stored without growing
+  void reserve(std::size_t n) {
+    if (n > maxLoad()) rehash(n + n / 4 + 1);
+  }
+
+  // Return nullptr if the id doesn't exist
+  auto find(const OrderId id) -> Value* {
+    auto idx = findIndex(id);
+    return idx == kNotFound ? nullptr : &slots_[idx].value;
+  }
+
+  auto find(const OrderId id) const -> const Value* {
+    auto idx = findIndex(id);
+    return idx == kNotFound ? nullptr : &slots_[idx].value;
+  }
+
+  bool contains(const OrderId id) const {
+    return findIndex(id) != kNotFound;
+  }
+
+  /*
+   * Find the value of the id, or insert a default value if it doesn't exist
+   * The bool is true if the value is inserted
+   */
+  auto findOrInsert(const OrderId id) -> std::pair<Value*, bool> {
+    if (size_ + 1 > maxLoad()) rehash(slots_.size() * 2);
+    auto idx = home(id);
+    std::uint32_t dist = 1;
+    while (true) {
+      auto& slot = slots_[idx];
+      if (slot.dist == 0 || slot.dist < dist) break;
+      if (slot.id == id) return {&slot.value, false};
+      idx = (idx + 1) & mask_;
+      ++dist;
+    }
+    // Insert at idx, the entries after it are pushed further in the probe sequence
+    auto inserted_idx = idx;
+    Slot entry{id, dist, Value{}};
+    while (slots_[idx].dist != 0) {
+      if (slots_[idx].dist < entry.dist) {
+        std::swap(entry, slots_[idx]);
+      }
+      idx = (idx + 1) & mask_;
+      ++entry.dist;
+    }
+    slots_[idx] = std::move(entry);
+    ++size_;
+    return {&slots_[inserted_idx].value, true};
+  }
+
+  /*
+   * Erase the id and move its value to value
+   * Return false if the id doesn't exist
+   */
+  bool findAndErase(const OrderId id, Value& value) {
+    auto idx = findIndex(id);
+    if (idx == kNotFound) return false;
+    value = std::move(slots_[idx].value);
+    eraseIndex(idx);
+    return true;
+  }
+
+  bool erase(const OrderId id) {
+    auto idx = findIndex(id);
+    if (idx == kNotFound) return false;
+    eraseIndex(idx);
+    return true;
+  }
+
+  // Erase the entry of a value returned by find or findOrInsert, without probing the id again
+  void erase(Value* value) {
+    auto slot = reinterpret_cast<Slot*>(reinterpret_cast<char*>(value) - offsetof(Slot, value));
+    eraseIndex(static_cast<std::size_t>(slot - slots_.data()));
+  }
+
+  void clear() {
+    for (auto& slot: slots_) {
+      slot.dist = 0;
+    }
+    size_ = 0;
+  }
+
+  // Visit all the entries, the order is unspecified
+  template <typename Fn>
+  void forEach(Fn&& fn) {
+    for (auto& slot: slots_) {
+      if (slot.dist != 0) fn(slot.id, slot.value);
+    }
+  }
+
+private:
+  static constexpr std::size_t kNotFound = static_cast<std::size_t>(-1);
+
+  struct Slot {
+    OrderId id;
+    // Distance to the home slot plus one, 0 means the slot is empty
+    std::uint32_t dist;
+    Value value;
+  };
+
+  // Fibonacci hashing spreads the consecutive ids assigned by exchanges
+  auto home(const OrderId id) const -> std::size_t {
+    auto hash = static_cast<std::uint64_t>(static_cast<std::uint32_t>(id)) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<std::size_t>(hash >> shift_);
+  }
+
+  // Keep the load factor below 7/8
+  auto maxLoad() const -> std::size_t { return slots_.size() - slots_.size() / 8; }
+
+  auto findIndex(const OrderId id) const -> std::size_t {
+    auto idx = home(id);
+    std::uint32_t dist = 1;
+    while (true) {
+      const auto& slot = slots_[idx];
+      // An entry of the id would have taken this slot
+      if (slot.dist == 0 || slot.dist < dist) return kNotFound;
+      if (slot.id == id) return idx;
+      idx = (idx + 1) & mask_;
+      ++dist;
+    }
+  }
+
+  void eraseIndex(std::size_t idx) {
+    auto next = (idx + 1) & mask_;
+    while (slots_[next].dist > 1) {
+      slots_[idx] = std::move(slots_[next]);
+      --slots_[idx].dist;
+      idx = next;
+      next = (next + 1) & mask_;
+    }
+    slots_[idx].dist = 0;
+    --size_;
+  }
+
+  void rehash(std::size_t capacity) {
+    std::size_t new_capacity = 16;
+    int bits = 4;
+    while (new_capacity < capacity) {
+      new_capacity <<= 1;
+      ++bits;
+    }
+    std::vector<Slot> old_slots(new_capacity, Slot{0, 0, Value{}});
+    old_slots.swap(slots_);
+    mask_ = new_capacity - 1;
+    shift_ = 64 - bits;
+    size_ = 0;
+    for (auto& slot: old_slots) {
+      if (slot.dist != 0) {
+        *findOrInsert(slot.id).first = std::move(slot.value);
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;
+  std::size_t mask_{0};
+  int shift_{64};
+  std::size_t size_{0};
+};
+
+} // namespace OrderBook
\ No newline at end of file
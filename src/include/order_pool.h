@@ -0,0 +1,67 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+#include "order.h"
+
+namespace OrderBook {
+
+/*
+ * Pool of Order objects for one book side
+ * Orders are handed out from preallocated slabs and recycled when they are removed from the book
+ * When the pool runs out, a new slab as large as the current capacity is added, so the capacity grows
+ * geometrically and the live orders never move
+ */
+class OrderPool {
+public:
+  explicit OrderPool(std::size_t initial_capacity = 1024);
+  ~OrderPool() = default;
+
+  OrderPool(const OrderPool& rhs) = delete;
+  OrderPool(OrderPool&& rhs) = delete;
+  OrderPool& operator=(const OrderPool& rhs) = delete;
+  OrderPool& operator=(OrderPool&& rhs) = delete;
+
+  // Copy the order into a free slot
+  auto create(const Order& order) -> Order* {
+    if (free_slots_.empty()) grow();
+    auto slot = free_slots_.back();
+    free_slots_.pop_back();
+    auto new_order = new (slot) Order(order);
+    new_order->prev = new_order->next = nullptr;
+    ++size_;
+    if (size_ > high_water_mark_) high_water_mark_ = size_;
+    return new_order;
+  }
+
+  // Give the slot back to the pool, assume the order is created by this pool
+  void destroy(Order* order) {
+    order->~Order();
+    free_slots_.push_back(reinterpret_cast<Slot*>(order));
+    --size_;
+  }
+
+  // Number of live orders
+  auto size() const -> std::size_t { return size_; }
+  auto capacity() const -> std::size_t { return capacity_; }
+  // The largest number of live orders seen so far
+  auto highWaterMark() const -> std::size_t { return high_water_mark_; }
+  auto numSlabs() const -> std::size_t { return slabs_.size(); }
+
+private:
+  struct alignas(alignof(Order)) Slot {
+    unsigned char data[sizeof(Order)];
+  };
+
+  void grow();
+
+  std::vector<std::unique_ptr<Slot[]>> slabs_;
+  std::vector<Slot*> free_slots_;
+  std::size_t capacity_{0};
+  std::size_t size_{0};
+  std::size_t high_water_mark_{0};
+  std::size_t next_slab_size_;
+};
+
+} // namespace OrderBook
\ No newline at end of file
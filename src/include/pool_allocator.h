@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace OrderBook {
+
+/*
+ * Fixed-size node pool shared by all the allocators with the same node size and alignment
+ *
+ * Freed nodes are kept in an intrusive free list and handed out again before a new chunk is carved
+ * The free list is per thread, so no lock is needed. A node freed on another thread joins that thread's list
+ * Chunks are never given back to the system, the pool only grows to the high water mark of the book
+ * The free nodes of a thread are lost when it exits, so containers are best freed on the thread allocating them
+ */
+template <std::size_t NodeSize, std::size_t NodeAlign>
+class NodePool {
+public:
+  static void* allocate() {
+    auto& state = local();
+    if (state.free_list == nullptr) refill(state);
+    auto node = state.free_list;
+    state.free_list = node->next;
+    return node;
+  }
+
+  static void deallocate(void* ptr) {
+    auto& state = local();
+    auto node = static_cast<FreeNode*>(ptr);
+    node->next = state.free_list;
+    state.free_list = node;
+  }
+
+private:
+  struct FreeNode {
+    FreeNode* next;
+  };
+
+  struct State {
+    FreeNode* free_list{nullptr};
+    std::size_t chunk_nodes{kInitialChunkNodes};
+  };
+
+  static constexpr std::size_t kInitialChunkNodes = 64;
+  static constexpr std::size_t kMaxChunkNodes = 4096;
+  static constexpr std::size_t kAlign = NodeAlign > alignof(FreeNode) ? NodeAlign : alignof(FreeNode);
+  // Round the node size up so that every node in a chunk keeps the alignment
+  static constexpr std::size_t kSize =
+    ((NodeSize > sizeof(FreeNode) ? NodeSize : sizeof(FreeNode)) + kAlign - 1) / kAlign * kAlign;
+
+  // State is trivially destructible, the thread local doesn't register a destructor
+  static auto local() -> State& {
+    static thread_local State state;
+    return state;
+  }
+
+  // Carve a new chunk into nodes, the chunk size doubles up to kMaxChunkNodes
+  static void refill(State& state) {
+    auto chunk = static_cast<std::byte*>(::operator new(kSize * state.chunk_nodes, std::align_val_t(kAlign)));
+    for (std::size_t i = state.chunk_nodes; i > 0; --i) {
+      auto node = reinterpret_cast<FreeNode*>(chunk + (i - 1) * kSize);
+      node->next = state.free_list;
+      state.free_list = node;
+    }
+    if (state.chunk_nodes < kMaxChunkNodes) state.chunk_nodes *= 2;
+  }
+};
+
+/*
+ * Stateless allocator for node based containers such as std::map, std::list and std::unordered_map
+ *
+ * Single object allocations, which are the tree and list nodes, come from the NodePool of their size
+ * Array allocations such as the bucket array of std::unordered_map fall back to std::allocator
+ */
+template <typename T>
+class PoolAllocator {
+public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  PoolAllocator() noexcept = default;
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  auto allocate(std::size_t n) -> T* {
+    if (n == 1) return static_cast<T*>(NodePool<sizeof(T), alignof(T)>::allocate());
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* ptr, std::size_t n) noexcept {
+    if (n == 1) {
+      NodePool<sizeof(T), alignof(T)>::deallocate(ptr);
+      return;
+    }
+    std::allocator<T>().deallocate(ptr, n);
+  }
+
+  template <typename U>
+  bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+  template <typename U>
+  bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+};
+
+} // namespace OrderBook
\ No newline at end of file
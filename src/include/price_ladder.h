@@ -0,0 +1,402 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "common.h"
+
+namespace OrderBook {
+
+/*
+ * Dense price ladder used as an alternative to std::map for one side of the book
+ *
+ * The ladder is a contiguous array of slots indexed by the tick offset from a moving anchor
+ * Each slot points to a level node. The nodes are stored in a deque and recycled, so the address of a level
+ * never changes even when the ladder is recentered or grows
+ *
+ * The index of the best level is cached. Finding the best level, adding to and removing from a level are O(1)
+ * Removing the best level scans to the next non-empty slot, which is normally next to it
+ *
+ * The window of slots grows up to max_capacity and always holds the best level. A level too far from the
+ * touch to fit in the window, e.g. a stub quote or a sentinel price, is kept in an overflow map instead
+ * The overflow levels are always worse than the window, when the window runs empty it moves to the best of them
+ *
+ * Iteration goes from the best level to the worst level as std::map does with the side comparator
+ * The comparator is only used to know the direction of the side at compile time
+ */
+template <typename LevelType, typename Comparator>
+class PriceLadder {
+public:
+  using key_type = Tick;
+  using mapped_type = LevelType;
+  using value_type = std::pair<Tick, LevelType>;
+  using size_type = std::size_t;
+
+private:
+  // The levels out of the window, from the best to the worst level
+  using Overflow = OneSideBook<value_type*, Comparator>;
+  using OverflowIter = typename Overflow::const_iterator;
+
+  template <bool IsConst>
+  class Iter {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = PriceLadder::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const value_type*, value_type*>;
+    using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+    using LadderPtr = std::conditional_t<IsConst, const PriceLadder*, PriceLadder*>;
+
+    Iter() = default;
+    Iter(LadderPtr ladder, std::ptrdiff_t idx, bool reverse) : ladder_(ladder), idx_(idx), reverse_(reverse) {}
+    Iter(LadderPtr ladder, OverflowIter overflow_iter, bool reverse)
+      : ladder_(ladder), idx_(kOverflow), overflow_iter_(overflow_iter), reverse_(reverse) {}
+    // Allow the conversion from iterator to const_iterator
+    template <bool C = IsConst, typename = std::enable_if_t<C>>
+    Iter(const Iter<false>& rhs)
+      : ladder_(rhs.ladder_), idx_(rhs.idx_), overflow_iter_(rhs.overflow_iter_), reverse_(rhs.reverse_) {}
+
+    reference operator*() const { return *operator->(); }
+    pointer operator->() const { return idx_ == kOverflow ? overflow_iter_->second : ladder_->slots_[idx_]; }
+
+    Iter& operator++() {
+      if (reverse_) {
+        stepBackward();
+      } else {
+        stepForward();
+      }
+      return *this;
+    }
+
+    Iter operator++(int) {
+      Iter tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const Iter& rhs) const {
+      return idx_ == rhs.idx_ && (idx_ != kOverflow || overflow_iter_ == rhs.overflow_iter_);
+    }
+    bool operator!=(const Iter& rhs) const { return !(*this == rhs); }
+
+  private:
+    friend class PriceLadder;
+    template <bool> friend class Iter;
+
+    // The window levels from the best to the worst, then the overflow levels
+    void stepForward() {
+      if (idx_ == kOverflow) {
+        if (++overflow_iter_ == ladder_->overflow_.end()) idx_ = kEnd;
+        return;
+      }
+      if (idx_ == ladder_->worst_) {
+        if (ladder_->overflow_.empty()) {
+          idx_ = kEnd;
+        } else {
+          idx_ = kOverflow;
+          overflow_iter_ = ladder_->overflow_.begin();
+        }
+        return;
+      }
+      // The worst index is occupied, so there is always a level before reaching it
+      do {
+        idx_ += ladder_->step();
+      } while (ladder_->slots_[idx_] == nullptr);
+    }
+
+    // The overflow levels from the worst to the best, then the window levels
+    void stepBackward() {
+      if (idx_ == kOverflow) {
+        if (overflow_iter_ == ladder_->overflow_.begin()) {
+          // The window is never empty while there are overflow levels
+          idx_ = ladder_->worst_;
+        } else {
+          --overflow_iter_;
+        }
+        return;
+      }
+      if (idx_ == ladder_->best_) {
+        idx_ = kEnd;
+        return;
+      }
+      do {
+        idx_ -= ladder_->step();
+      } while (ladder_->slots_[idx_] == nullptr);
+    }
+
+    LadderPtr ladder_{nullptr};
+    std::ptrdiff_t idx_{kEnd};
+    OverflowIter overflow_iter_{};
+    bool reverse_{false};
+  };
+
+public:
+  using iterator = Iter<false>;
+  using const_iterator = Iter<true>;
+  using reverse_iterator = Iter<false>;
+  using const_reverse_iterator = Iter<true>;
+
+  explicit PriceLadder(const Comparator& = Comparator(), size_type capacity = kDefaultCapacity,
+                       size_type max_capacity = kDefaultMaxCapacity)
+    : slots_(roundUpCapacity(std::min(capacity, max_capacity))), max_capacity_(roundUpCapacity(max_capacity)) {}
+  ~PriceLadder() = default;
+
+  PriceLadder(const PriceLadder& rhs) = delete;
+  PriceLadder(PriceLadder&& rhs) = default;
+  PriceLadder& operator=(const PriceLadder& rhs) = delete;
+  PriceLadder& operator=(PriceLadder&& rhs) = default;
+
+  auto begin() -> iterator { return empty() ? end() : iterator(this, best_, false); }
+  auto end() -> iterator { return iterator(this, kEnd, false); }
+  auto begin() const -> const_iterator { return cbegin(); }
+  auto end() const -> const_iterator { return cend(); }
+  auto cbegin() const -> const_iterator { return empty() ? cend() : const_iterator(this, best_, false); }
+  auto cend() const -> const_iterator { return const_iterator(this, kEnd, false); }
+  auto rbegin() -> reverse_iterator {
+    if (empty()) return rend();
+    return overflow_.empty() ? reverse_iterator(this, worst_, true)
+                             : reverse_iterator(this, std::prev(overflow_.cend()), true);
+  }
+  auto rend() -> reverse_iterator { return reverse_iterator(this, kEnd, true); }
+  auto rbegin() const -> const_reverse_iterator { return crbegin(); }
+  auto rend() const -> const_reverse_iterator { return crend(); }
+  auto crbegin() const -> const_reverse_iterator {
+    if (empty()) return crend();
+    return overflow_.empty() ? const_reverse_iterator(this, worst_, true)
+                             : const_reverse_iterator(this, std::prev(overflow_.cend()), true);
+  }
+  auto crend() const -> const_reverse_iterator { return const_reverse_iterator(this, kEnd, true); }
+
+  bool empty() const { return size() == 0; }
+  auto size() const -> size_type { return window_size_ + overflow_.size(); }
+  // Number of slots of the window, at most maxCapacity
+  auto capacity() const -> size_type { return slots_.size(); }
+  auto maxCapacity() const -> size_type { return max_capacity_; }
+  // Number of levels out of the window
+  auto overflowSize() const -> size_type { return overflow_.size(); }
+
+  auto find(const Tick price) -> iterator {
+    auto idx = indexOf(price);
+    if (occupied(idx)) return iterator(this, idx, false);
+    auto iter = overflow_.find(price);
+    return iter == overflow_.end() ? end() : iterator(this, iter, false);
+  }
+
+  auto find(const Tick price) const -> const_iterator {
+    auto idx = indexOf(price);
+    if (occupied(idx)) return const_iterator(this, idx, false);
+    auto iter = overflow_.find(price);
+    return iter == overflow_.end() ? cend() : const_iterator(this, iter, false);
+  }
+
+  auto count(const Tick price) const -> size_type {
+    return occupied(indexOf(price)) || overflow_.count(price) != 0 ? 1 : 0;
+  }
+
+  // Get the level at the price, create an empty level if it doesn't exist
+  auto operator[](const Tick price) -> LevelType& {
+    auto idx = indexOf(price);
+    if (!inWindow(idx)) {
+      auto iter = overflow_.find(price);
+      if (iter != overflow_.end()) return iter->second->second;
+      if (!moveWindow(price)) {
+        // Too far from the touch for the window
+        return overflow_.emplace(price, newNode(price)).first->second->second;
+      }
+      idx = indexOf(price);
+    }
+    if (slots_[idx] == nullptr) {
+      slots_[idx] = newNode(price);
+      if (window_size_ == 0) {
+        best_ = worst_ = idx;
+      } else {
+        if (better(idx, best_)) best_ = idx;
+        if (better(worst_, idx)) worst_ = idx;
+      }
+      ++window_size_;
+    }
+    return slots_[idx]->second;
+  }
+
+  auto erase(const Tick price) -> size_type {
+    auto idx = indexOf(price);
+    if (!occupied(idx)) {
+      auto iter = overflow_.find(price);
+      if (iter == overflow_.end()) return 0;
+      free_nodes_.push_back(iter->second);
+      overflow_.erase(iter);
+      return 1;
+    }
+    free_nodes_.push_back(slots_[idx]);
+    slots_[idx] = nullptr;
+    --window_size_;
+    if (window_size_ == 0) {
+      // Keep the best level in the window
+      if (!overflow_.empty()) relocate(touchAnchor(overflow_.begin()->first, capacity()), capacity());
+      return 1;
+    }
+    // Move the cached best and worst index to the next non-empty slot
+    if (idx == best_) {
+      do {
+        best_ += step();
+      } while (slots_[best_] == nullptr);
+    } else if (idx == worst_) {
+      do {
+        worst_ -= step();
+      } while (slots_[worst_] == nullptr);
+    }
+    return 1;
+  }
+
+  void clear() {
+    if (window_size_ != 0) {
+      for (auto idx = lowIndex(); idx <= highIndex(); ++idx) {
+        if (slots_[idx] != nullptr) free_nodes_.push_back(slots_[idx]);
+        slots_[idx] = nullptr;
+      }
+    }
+    for (const auto& [price, node]: overflow_) {
+      free_nodes_.push_back(node);
+    }
+    overflow_.clear();
+    window_size_ = 0;
+  }
+
+private:
+  static constexpr std::ptrdiff_t kEnd = -1;
+  static constexpr std::ptrdiff_t kOverflow = -2;
+  static constexpr bool kDescending = Comparator()(1, 0);
+  static constexpr size_type kDefaultCapacity = 256;
+  // 512KB of slots at most, the window covers 65536 ticks around the touch
+  static constexpr size_type kDefaultMaxCapacity = 65536;
+
+  static auto roundUpCapacity(size_type capacity) -> size_type {
+    size_type result = 16;
+    while (result < capacity) result <<= 1;
+    return result;
+  }
+
+  // Direction from the best level to the worst level in the slots
+  auto step() const -> std::ptrdiff_t { return kDescending ? -1 : 1; }
+  bool better(std::ptrdiff_t lhs, std::ptrdiff_t rhs) const { return kDescending ? lhs > rhs : lhs < rhs; }
+  auto lowIndex() const -> std::ptrdiff_t { return kDescending ? worst_ : best_; }
+  auto highIndex() const -> std::ptrdiff_t { return kDescending ? best_ : worst_; }
+
+  auto indexOf(const Tick price) const -> std::ptrdiff_t {
+    return static_cast<std::ptrdiff_t>(price - anchor_);
+  }
+
+  bool inWindow(std::ptrdiff_t idx) const {
+    return idx >= 0 && idx < static_cast<std::ptrdiff_t>(slots_.size());
+  }
+
+  bool occupied(std::ptrdiff_t idx) const {
+    return inWindow(idx) && slots_[idx] != nullptr;
+  }
+
+  auto newNode(const Tick price) -> value_type* {
+    if (free_nodes_.empty()) {
+      nodes_.emplace_back(price, LevelType());
+      return &nodes_.back();
+    }
+    auto node = free_nodes_.back();
+    free_nodes_.pop_back();
+    node->first = price;
+    node->second = LevelType();
+    return node;
+  }
+
+  // Anchor of a window with the touch a quarter of the capacity away from its better end
+  static auto touchAnchor(const Tick touch, size_type capacity) -> Tick {
+    auto margin = static_cast<Tick>(capacity / 4);
+    return kDescending ? touch + margin - static_cast<Tick>(capacity) + 1 : touch - margin;
+  }
+
+  /*
+   * Move the window so that the price out of it fits, return false if the price goes to the overflow
+   * The window doubles its capacity when the occupied range would use more than half of it, up to max_capacity_
+   * If the range still doesn't fit, a price worse than the window goes to the overflow and a better price
+   * moves the window to it, the levels left out of the window go to the overflow
+   */
+  bool moveWindow(const Tick price) {
+    auto capacity = slots_.size();
+    if (window_size_ == 0) {
+      anchor_ = price - static_cast<Tick>(capacity / 2);
+      return true;
+    }
+    Tick low = std::min(anchor_ + lowIndex(), price);
+    Tick high = std::max(anchor_ + highIndex(), price);
+    // Unsigned, so that a far price can't overflow the span
+    auto span = static_cast<std::uint64_t>(high) - static_cast<std::uint64_t>(low) + 1;
+    while (span > capacity / 2 && capacity < max_capacity_) capacity *= 2;
+    if (span <= capacity) {
+      relocate(low - static_cast<Tick>((capacity - span) / 2), capacity);
+      return true;
+    }
+    if (Comparator()(anchor_ + worst_, price)) return false;
+    relocate(touchAnchor(price, capacity), capacity);
+    return true;
+  }
+
+  /*
+   * Move the window to the anchor with the capacity
+   * Only the slot pointers move, the levels stay where they are
+   * The window levels out of the new window go to the overflow, the overflow levels in it come back to the window
+   */
+  void relocate(const Tick new_anchor, size_type capacity) {
+    std::vector<value_type*> new_slots(capacity, nullptr);
+    size_type window_size = 0;
+    std::ptrdiff_t best = 0;
+    std::ptrdiff_t worst = 0;
+    auto place = [&](value_type* node) {
+      auto idx = static_cast<std::ptrdiff_t>(node->first - new_anchor);
+      new_slots[idx] = node;
+      if (window_size++ == 0) {
+        best = worst = idx;
+      } else {
+        if (better(idx, best)) best = idx;
+        if (better(worst, idx)) worst = idx;
+      }
+    };
+    auto fits = [new_anchor, capacity](const Tick price) {
+      return price >= new_anchor && static_cast<std::uint64_t>(price - new_anchor) < capacity;
+    };
+
+    if (window_size_ != 0) {
+      for (auto idx = lowIndex(); idx <= highIndex(); ++idx) {
+        auto node = slots_[idx];
+        if (node == nullptr) continue;
+        if (fits(node->first)) {
+          place(node);
+        } else {
+          overflow_.emplace(node->first, node);
+        }
+      }
+    }
+    // The overflow levels are worse than the window, the ones in the new window are at the front
+    while (!overflow_.empty() && fits(overflow_.begin()->first)) {
+      place(overflow_.begin()->second);
+      overflow_.erase(overflow_.begin());
+    }
+    anchor_ = new_anchor;
+    slots_.swap(new_slots);
+    window_size_ = window_size;
+    best_ = best;
+    worst_ = worst;
+  }
+
+  Tick anchor_{0};
+  std::vector<value_type*> slots_;
+  std::ptrdiff_t best_{0};
+  std::ptrdiff_t worst_{0};
+  size_type window_size_{0};
+  size_type max_capacity_;
+  Overflow overflow_;
+  std::deque<value_type> nodes_;
+  std::vector<value_type*> free_nodes_;
+};
+
+} // namespace OrderBook
\ No newline at end of file
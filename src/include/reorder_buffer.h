@@ -0,0 +1,114 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "message.h"
+
+namespace OrderBook {
+
+/*
+ * Merge the order, trade and snapshot streams in exchange timestamp order
+ *
+ * The messages are held in a min heap on the timestamp for a window after the newest timestamp seen.
+ * A message is released once it's older than the newest timestamp minus the window, so a stream lagging
+ * by less than the window is put back in order before the book sees it
+ * At the same timestamp, orders come before trades and trades before snapshots, since an order causes
+ * the trades and the snapshot shows the result. Otherwise the arrival order is kept
+ * A message older than the last released one is too late to be reordered, it's released right away
+ * The messages stay in their slots while the heap only moves small keys, the freed slots are reused
+ */
+class ReorderBuffer {
+public:
+  // Nothing is buffered with a zero window, so the buffers are only reserved for a non zero one
+  explicit ReorderBuffer(Timestamp window) : window_(window) {
+    if (window_ == 0) return;
+    heap_.reserve(1024);
+    slots_.reserve(1024);
+    free_slots_.reserve(1024);
+  }
+
+  auto window() const -> Timestamp { return window_; }
+  auto size() const -> std::size_t { return heap_.size(); }
+  bool empty() const { return heap_.empty(); }
+  // Number of messages which arrived after the window
+  auto lateCount() const -> std::size_t { return late_count_; }
+
+  // Buffer the message and call release on the messages out of the window, in timestamp order
+  template <typename Func>
+  void push(BookMessage msg, Func&& release) {
+    auto timestamp = timestampOf(msg);
+    if (released_any_ && timestamp < last_released_) {
+      ++late_count_;
+      release(msg);
+      return;
+    }
+    heap_.push_back({timestamp, msg.index(), next_seq_++, storeMessage(std::move(msg))});
+    std::push_heap(heap_.begin(), heap_.end(), Later());
+    newest_ = std::max(newest_, timestamp);
+    while (!heap_.empty() && heap_.front().timestamp + window_ <= newest_) {
+      releaseTop(release);
+    }
+  }
+
+  // Release all the buffered messages, in timestamp order
+  template <typename Func>
+  void flush(Func&& release) {
+    while (!heap_.empty()) {
+      releaseTop(release);
+    }
+  }
+
+private:
+  // Heap entry of a buffered message, the message itself is in slots_
+  struct Key {
+    Timestamp timestamp;
+    std::size_t stream;
+    std::uint64_t seq;
+    std::size_t slot;
+  };
+
+  // Order of the heap, the top is the entry to release first
+  struct Later {
+    bool operator()(const Key& lhs, const Key& rhs) const {
+      if (lhs.timestamp != rhs.timestamp) return lhs.timestamp > rhs.timestamp;
+      if (lhs.stream != rhs.stream) return lhs.stream > rhs.stream;
+      return lhs.seq > rhs.seq;
+    }
+  };
+
+  // Put the message in a free slot, or in a new one, and return the slot
+  auto storeMessage(BookMessage&& msg) -> std::size_t {
+    if (free_slots_.empty()) {
+      slots_.push_back(std::move(msg));
+      return slots_.size() - 1;
+    }
+    auto slot = free_slots_.back();
+    free_slots_.pop_back();
+    slots_[slot] = std::move(msg);
+    return slot;
+  }
+
+  template <typename Func>
+  void releaseTop(Func& release) {
+    std::pop_heap(heap_.begin(), heap_.end(), Later());
+    auto key = heap_.back();
+    heap_.pop_back();
+    last_released_ = key.timestamp;
+    released_any_ = true;
+    release(slots_[key.slot]);
+    free_slots_.push_back(key.slot);
+  }
+
+  Timestamp window_;
+  std::vector<Key> heap_;
+  std::vector<BookMessage> slots_;
+  std::vector<std::size_t> free_slots_;
+  Timestamp newest_{0};
+  Timestamp last_released_{0};
+  bool released_any_{false};
+  std::uint64_t next_seq_{0};
+  std::size_t late_count_{0};
+};
+
+} // namespace OrderBook
\ No newline at end of file
@@ -0,0 +1,193 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "book_manager.h"
+#include "spsc_ring.h"
+
+namespace OrderBook {
+
+struct ShardConfig {
+  // Core of the worker thread of each shard, a negative core leaves the thread unpinned
+  std::vector<int> cores;
+  // Shard of each instrument, the instruments are spread round robin when it's empty
+  std::vector<std::size_t> instrument_shards;
+  // Config of the book of each instrument, all the books use kSmallBookConfig when it's empty
+  std::vector<BookConfig> book_configs;
+  // Capacity of the ring of each shard
+  std::size_t ring_capacity{65536};
+  // How the workers wait on an empty ring
+  WaitMode wait_mode{WaitMode::BUSY_POLL};
+};
+
+// Pin the calling thread to the core, return false if it's not supported or failed
+// A worker that can't be pinned logs it and keeps running unpinned
+bool pinCurrentThread(int core);
+
+/*
+ * Book manager with the instruments partitioned across shards
+ *
+ * Each shard has a worker thread owning a BookManager with the books of its instruments, so the book state is
+ * never shared and no lock is taken. The dispatcher, the single thread calling dispatch, routes every message
+ * to the single producer single consumer ring of its shard
+ * Each shard has its own listener, only called from the worker thread of the shard
+ * In the listener, the instrument of a book is its index in the shard, see localInstrument
+ *
+ * With ORDERBOOK_POOL_ALLOCATOR, the book nodes come from the per thread NodePool of the worker, but the books are
+ * destroyed with the manager on the thread owning it, so their nodes join the free lists of that thread. The memory
+ * is never shared between two live free lists, the worker chunks are only held until the process exits
+ * Keep the manager for the lifetime of the feed, or turn the option off when managers are created and destroyed often
+ */
+template <typename Listener = OrderEventListener>
+class ShardedBookManager {
+public:
+  ShardedBookManager(const std::vector<Listener*>& listeners, std::size_t num_instruments, ShardConfig config = {});
+  ~ShardedBookManager() { stop(); }
+
+  ShardedBookManager(const ShardedBookManager& rhs) = delete;
+  ShardedBookManager(ShardedBookManager&& rhs) = delete;
+  ShardedBookManager& operator=(const ShardedBookManager& rhs) = delete;
+  ShardedBookManager& operator=(ShardedBookManager&& rhs) = delete;
+
+  /*
+   * Route the message to the shard of its instrument, spin while the ring of the shard is full
+   * Return false and drop the message if its instrument id is out of range or the manager is stopped
+   */
+  bool dispatch(BookMessage msg);
+
+  // Wait until the workers processed all the dispatched messages, called from the dispatcher
+  void waitIdle() const;
+
+  // Let the workers drain their rings and join them
+  void stop();
+
+  auto numShards() const -> std::size_t { return shards_.size(); }
+  auto shardOf(InstrumentId instrument) const -> std::size_t { return routes_[instrument].shard; }
+  auto localInstrument(InstrumentId instrument) const -> InstrumentId { return routes_[instrument].local; }
+  // Number of messages rejected by dispatch
+  auto droppedMessageCount() const -> std::size_t { return dropped_message_count_; }
+
+  // Only safe to read after waitIdle or stop
+  auto book(InstrumentId instrument) -> SmartOrderBook& {
+    const auto& route = routes_[instrument];
+    return shards_[route.shard]->manager.book(route.local);
+  }
+
+private:
+  struct Route {
+    std::size_t shard;
+    InstrumentId local;
+  };
+
+  struct Shard {
+    Shard(Listener& listener, const std::vector<BookConfig>& book_configs, std::size_t ring_capacity,
+          WaitMode wait_mode)
+      : manager(listener, book_configs), ring(ring_capacity, wait_mode) {}
+
+    BookManager<Listener> manager;
+    SpscRing<BookMessage> ring;
+    // Written by the worker only
+    alignas(64) std::atomic<std::uint64_t> processed{0};
+    // Written by the dispatcher only
+    alignas(64) std::uint64_t dispatched{0};
+    std::thread worker;
+  };
+
+  void run(Shard& shard, int core);
+
+  std::vector<Route> routes_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::size_t dropped_message_count_{0};
+};
+
+template <typename Listener>
+ShardedBookManager<Listener>::ShardedBookManager(const std::vector<Listener*>& listeners,
+                                                 std::size_t num_instruments, ShardConfig config) {
+  auto num_shards = listeners.size();
+  assert(num_shards > 0);
+  assert(config.book_configs.empty() || config.book_configs.size() == num_instruments);
+  // Give each instrument its index in the shard, the configs of the books of a shard are in the same order
+  std::vector<std::vector<BookConfig>> shard_configs(num_shards);
+  routes_.reserve(num_instruments);
+  for (std::size_t instrument = 0; instrument < num_instruments; ++instrument) {
+    auto shard = config.instrument_shards.empty() ? instrument % num_shards : config.instrument_shards[instrument];
+    assert(shard < num_shards);
+    routes_.push_back({shard, static_cast<InstrumentId>(shard_configs[shard].size())});
+    shard_configs[shard].push_back(config.book_configs.empty() ? kSmallBookConfig : config.book_configs[instrument]);
+  }
+  for (std::size_t shard = 0; shard < num_shards; ++shard) {
+    shards_.push_back(
+      std::make_unique<Shard>(*listeners[shard], shard_configs[shard], config.ring_capacity, config.wait_mode));
+  }
+  for (std::size_t shard = 0; shard < num_shards; ++shard) {
+    int core = shard < config.cores.size() ? config.cores[shard] : -1;
+    shards_[shard]->worker = std::thread([this, shard, core] { run(*shards_[shard], core); });
+  }
+}
+
+template <typename Listener>
+bool ShardedBookManager<Listener>::dispatch(BookMessage msg) {
+  auto instrument = instrumentOf(msg);
+  if (instrument >= routes_.size()) {
+    ++dropped_message_count_;
+    return false;
+  }
+  const auto& route = routes_[instrument];
+  // The books of a shard are indexed by the local instrument
+  std::visit([&route](auto& m) { m.instrument = route.local; }, msg);
+  auto& shard = *shards_[route.shard];
+  // Nothing drains a closed ring, so the message would never be processed
+  while (!shard.ring.closed()) {
+    if (shard.ring.tryPush(std::move(msg))) {
+      ++shard.dispatched;
+      return true;
+    }
+    std::this_thread::yield();
+  }
+  ++dropped_message_count_;
+  return false;
+}
+
+template <typename Listener>
+void ShardedBookManager<Listener>::waitIdle() const {
+  for (const auto& shard: shards_) {
+    while (shard->processed.load(std::memory_order_acquire) != shard->dispatched) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+template <typename Listener>
+void ShardedBookManager<Listener>::stop() {
+  for (auto& shard: shards_) {
+    if (!shard->ring.closed()) shard->ring.close();
+  }
+  for (auto& shard: shards_) {
+    if (shard->worker.joinable()) shard->worker.join();
+  }
+}
+
+template <typename Listener>
+void ShardedBookManager<Listener>::run(Shard& shard, int core) {
+  if (core >= 0 && !pinCurrentThread(core)) {
+    std::cerr << "[ShardedBookManager]: Failed to pin the worker to core " << core << std::endl;
+  }
+  while (true) {
+    // Check closed before draining, so the messages dispatched before stop are processed
+    bool closed = shard.ring.closed();
+    auto count = shard.manager.drain(shard.ring);
+    if (count > 0) {
+      shard.processed.store(shard.processed.load(std::memory_order_relaxed) + count, std::memory_order_release);
+      continue;
+    }
+    if (closed) break;
+    shard.ring.waitForData();
+  }
+}
+
+} // namespace OrderBook
\ No newline at end of file
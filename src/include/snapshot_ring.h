@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "level.h"
+
+namespace OrderBook {
+
+/*
+ * Fixed capacity ring of the expected L2 snapshot fingerprints of one book side
+ *
+ * The ring is allocated once. When it's full, pushing overwrites the oldest entry
+ * An incoming snapshot can skip forward to its matching entry, the older entries are stale and discarded
+ * Every overwritten or discarded entry is counted as dropped
+ */
+class SnapshotRing {
+public:
+  using size_type = std::size_t;
+
+  explicit SnapshotRing(size_type capacity = kDefaultCapacity)
+    : slots_(roundUpCapacity(capacity)), mask_(slots_.size() - 1) {}
+
+  bool empty() const { return size_ == 0; }
+  auto size() const -> size_type { return size_; }
+  auto capacity() const -> size_type { return slots_.size(); }
+  auto dropped() const -> size_type { return dropped_; }
+
+  // Assume the ring is not empty
+  auto front() const -> L2Fingerprint { return slots_[head_]; }
+
+  void push_back(const L2Fingerprint fingerprint) {
+    if (size_ == slots_.size()) {
+      // Overwrite the oldest entry
+      head_ = (head_ + 1) & mask_;
+      --size_;
+      ++dropped_;
+    }
+    slots_[(head_ + size_) & mask_] = fingerprint;
+    ++size_;
+  }
+
+  // Assume the ring is not empty
+  void pop_front() {
+    head_ = (head_ + 1) & mask_;
+    --size_;
+  }
+
+  // Position of the oldest entry matching the fingerprint, size() if there is none
+  auto find(const L2Fingerprint fingerprint) const -> size_type {
+    for (size_type i = 0; i < size_; ++i) {
+      if (slots_[(head_ + i) & mask_] == fingerprint) return i;
+    }
+    return size_;
+  }
+
+  // Discard the count oldest entries, they are counted as dropped
+  void skip(const size_type count) {
+    head_ = (head_ + count) & mask_;
+    size_ -= count;
+    dropped_ += count;
+  }
+
+  void clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+private:
+  static constexpr size_type kDefaultCapacity = 1024;
+
+  static auto roundUpCapacity(size_type capacity) -> size_type {
+    size_type result = 1;
+    while (result < capacity) result <<= 1;
+    return result;
+  }
+
+  std::vector<L2Fingerprint> slots_;
+  size_type mask_;
+  size_type head_{0};
+  size_type size_{0};
+  size_type dropped_{0};
+};
+
+} // namespace OrderBook
\ No newline at end of file
@@ -0,0 +1,149 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
+#include "common.h"
+#include "level.h"
+#include "message.h"
+
+namespace OrderBook {
+
+/*
+ * Wire layout of an L2 snapshot, the fields are packed in host byte order
+ *   header:   uint32 instrument, uint64 timestamp
+ *   bid side: uint32 count, then count levels of {int64 price in ticks, int32 quantity}
+ *   ask side: same layout as the bid side
+ * The levels of a side are sorted from the best to the worst level as in SnapshotMessage
+ */
+namespace SnapshotWire {
+inline constexpr std::size_t kCountBytes = sizeof(std::uint32_t);
+inline constexpr std::size_t kLevelBytes = sizeof(Tick) + sizeof(Quantity);
+inline constexpr std::size_t kHeaderBytes = sizeof(InstrumentId) + sizeof(Timestamp);
+
+// The fields are not aligned in the buffer, memcpy is the well-defined unaligned load
+template <typename T>
+inline auto load(const std::byte* data) -> T {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+} // namespace SnapshotWire
+
+/*
+ * Non-owning view of one side of a snapshot in the wire buffer
+ * The levels are decoded when they are read, so the view can be iterated as an L2SnapshotSide without copying
+ * The buffer must outlive the view
+ */
+class L2SnapshotView {
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = L2PriceLevel;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const L2PriceLevel*;
+    // The level is decoded on the fly, so it's returned by value
+    using reference = L2PriceLevel;
+
+    const_iterator() = default;
+    explicit const_iterator(const std::byte* pos) : pos_(pos) {}
+
+    auto operator*() const -> L2PriceLevel {
+      return L2PriceLevel(SnapshotWire::load<Tick>(pos_), SnapshotWire::load<Quantity>(pos_ + sizeof(Tick)));
+    }
+
+    const_iterator& operator++() {
+      pos_ += SnapshotWire::kLevelBytes;
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+
+    bool operator==(const const_iterator& rhs) const { return pos_ == rhs.pos_; }
+    bool operator!=(const const_iterator& rhs) const { return pos_ != rhs.pos_; }
+
+  private:
+    const std::byte* pos_{nullptr};
+  };
+  using iterator = const_iterator;
+  using value_type = L2PriceLevel;
+  using size_type = std::size_t;
+
+  L2SnapshotView() = default;
+
+  // Parse the side at the front of the buffer, the view is invalid if the buffer is shorter than its levels
+  explicit L2SnapshotView(Span<const std::byte> buffer) {
+    if (buffer.size() < SnapshotWire::kCountBytes) return;
+    auto count = SnapshotWire::load<std::uint32_t>(buffer.data());
+    if ((buffer.size() - SnapshotWire::kCountBytes) / SnapshotWire::kLevelBytes < count) return;
+    levels_ = buffer.data() + SnapshotWire::kCountBytes;
+    size_ = count;
+    valid_ = true;
+  }
+
+  auto begin() const -> const_iterator { return const_iterator(levels_); }
+  auto end() const -> const_iterator { return const_iterator(levels_ + size_ * SnapshotWire::kLevelBytes); }
+  auto size() const -> size_type { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool valid() const { return valid_; }
+
+  // Assume idx < size()
+  auto operator[](size_type idx) const -> L2PriceLevel {
+    return *const_iterator(levels_ + idx * SnapshotWire::kLevelBytes);
+  }
+
+  // Number of bytes of the side in the buffer, including the level count
+  auto bytes() const -> size_type { return SnapshotWire::kCountBytes + size_ * SnapshotWire::kLevelBytes; }
+
+private:
+  const std::byte* levels_{nullptr};
+  size_type size_{0};
+  bool valid_{false};
+};
+
+/*
+ * Non-owning view of a whole snapshot in the wire buffer, the zero-copy counterpart of SnapshotMessage
+ * The feed handler can hand the received buffer to the book directly, nothing is allocated or copied
+ * A truncated buffer gives an invalid view, which is checked with valid() before processing it
+ */
+class SnapshotView {
+public:
+  SnapshotView() = default;
+
+  explicit SnapshotView(Span<const std::byte> buffer) {
+    if (buffer.size() < SnapshotWire::kHeaderBytes) return;
+    instrument_ = SnapshotWire::load<InstrumentId>(buffer.data());
+    timestamp_ = SnapshotWire::load<Timestamp>(buffer.data() + sizeof(InstrumentId));
+    auto remaining = buffer.subspan(SnapshotWire::kHeaderBytes, buffer.size() - SnapshotWire::kHeaderBytes);
+    bid_levels_ = L2SnapshotView(remaining);
+    if (!bid_levels_.valid()) return;
+    remaining = remaining.subspan(bid_levels_.bytes(), remaining.size() - bid_levels_.bytes());
+    ask_levels_ = L2SnapshotView(remaining);
+  }
+
+  auto bidLevels() const -> const L2SnapshotView& { return bid_levels_; }
+  auto askLevels() const -> const L2SnapshotView& { return ask_levels_; }
+  auto instrument() const -> InstrumentId { return instrument_; }
+  auto timestamp() const -> Timestamp { return timestamp_; }
+  bool valid() const { return bid_levels_.valid() && ask_levels_.valid(); }
+
+  // Number of bytes of the snapshot in the buffer, the next message of the packet starts right after it
+  auto bytes() const -> std::size_t { return SnapshotWire::kHeaderBytes + bid_levels_.bytes() + ask_levels_.bytes(); }
+
+private:
+  L2SnapshotView bid_levels_;
+  L2SnapshotView ask_levels_;
+  InstrumentId instrument_{0};
+  Timestamp timestamp_{0};
+};
+
+// Append the snapshot to the buffer in the wire layout, used by the producers and the tests
+void encodeSnapshot(const SnapshotMessage& msg, std::vector<std::byte>& buffer);
+
+} // namespace OrderBook
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace OrderBook {
+
+/*
+ * How the consumer waits for data on an empty ring
+ * BUSY_POLL: spin on the ring and let the caller poll again, lowest latency but burns the core
+ * BLOCKING: spin for a short while, then sleep on a futex until the producer pushes
+ */
+enum class WaitMode {
+  BUSY_POLL,
+  BLOCKING
+};
+
+// Sleep while the word still holds the expected value, fall back to yielding where futex is not available
+void futexWait(std::atomic<std::uint32_t>& word, std::uint32_t expected);
+void futexWakeAll(std::atomic<std::uint32_t>& word);
+// Hint to the core that the thread is spinning
+void cpuRelax();
+
+/*
+ * Bounded single producer single consumer ring
+ *
+ * One thread pushes and one other thread pops, no lock is taken and both sides are wait-free
+ * The producer publishes a slot by storing the tail with release order and the consumer frees it by storing
+ * the head with release order. Each side keeps a cached copy of the other index on its own cache line
+ * and only reloads it when the ring looks full or empty, so the indices don't bounce between the cores
+ * The consumer can drain a batch with one load of the tail and one store of the head
+ */
+template <typename T>
+class SpscRing {
+public:
+  explicit SpscRing(std::size_t capacity = 4096, WaitMode wait_mode = WaitMode::BUSY_POLL)
+    : slots_(roundUpCapacity(capacity)), mask_(slots_.size() - 1), wait_mode_(wait_mode) {}
+
+  SpscRing(const SpscRing& rhs) = delete;
+  SpscRing(SpscRing&& rhs) = delete;
+  SpscRing& operator=(const SpscRing& rhs) = delete;
+  SpscRing& operator=(SpscRing&& rhs) = delete;
+
+  auto capacity() const -> std::size_t { return slots_.size(); }
+  auto waitMode() const -> WaitMode { return wait_mode_; }
+
+  // Producer side, return false if the ring is full and the value is left untouched
+  template <typename U>
+  bool tryPush(U&& value) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == slots_.size()) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == slots_.size()) return false;
+    }
+    slots_[tail & mask_] = std::forward<U>(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    if (wait_mode_ == WaitMode::BLOCKING) wakeConsumer();
+    return true;
+  }
+
+  // Consumer side, return std::nullopt if the ring is empty
+  auto tryPop() -> std::optional<T> {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) return std::nullopt;
+    }
+    std::optional<T> value(std::move(slots_[head & mask_]));
+    head_.store(head + 1, std::memory_order_release);
+    return value;
+  }
+
+  /*
+   * Consumer side, call func on at most max_count values in place and return the number of values consumed
+   * The slots are given back to the producer once at the end of the batch
+   */
+  template <typename Func>
+  auto consume(Func&& func, std::size_t max_count) -> std::size_t {
+    auto head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) tail_cache_ = tail_.load(std::memory_order_acquire);
+    auto count = std::min(tail_cache_ - head, max_count);
+    for (std::size_t i = 0; i < count; ++i) {
+      func(slots_[(head + i) & mask_]);
+    }
+    if (count > 0) head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  /*
+   * Consumer side, wait for data after the ring is found empty
+   * Busy poll mode only spins for a while. Blocking mode returns when the ring is not empty or closed
+   */
+  void waitForData() {
+    for (int spin = 0; spin < kSpinCount; ++spin) {
+      if (!empty() || closed()) return;
+      cpuRelax();
+    }
+    if (wait_mode_ == WaitMode::BUSY_POLL) return;
+    auto wake_seq = wake_seq_.load(std::memory_order_acquire);
+    sleeping_.store(true, std::memory_order_relaxed);
+    // Pairs with the fence in wakeConsumer, either the producer sees sleeping_ or the consumer sees the value
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (empty() && !closed()) futexWait(wake_seq_, wake_seq);
+    sleeping_.store(false, std::memory_order_relaxed);
+  }
+
+  // Producer side, no value will be pushed anymore. The consumer is woken up to drain the ring
+  void close() {
+    closed_.store(true, std::memory_order_release);
+    notify();
+  }
+
+  bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+  // Only a hint when called from another thread than the consumer
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  static constexpr int kSpinCount = 256;
+
+  static auto roundUpCapacity(std::size_t capacity) -> std::size_t {
+    std::size_t result = 2;
+    while (result < capacity) result <<= 1;
+    return result;
+  }
+
+  void wakeConsumer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) notify();
+  }
+
+  void notify() {
+    wake_seq_.fetch_add(1, std::memory_order_release);
+    futexWakeAll(wake_seq_);
+  }
+
+  std::vector<T> slots_;
+  std::size_t mask_;
+  WaitMode wait_mode_;
+  // Consumer line: its index and its cached copy of the producer index
+  alignas(64) std::atomic<std::size_t> head_{0};
+  std::size_t tail_cache_{0};
+  // Producer line: its index and its cached copy of the consumer index
+  alignas(64) std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_{0};
+  // Only used in blocking mode
+  alignas(64) std::atomic<std::uint32_t> wake_seq_{0};
+  std::atomic<bool> sleeping_{false};
+  std::atomic<bool> closed_{false};
+};
+
+} // namespace OrderBook
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "common.h"
+
+namespace OrderBook {
+
+/*
+ * Map the venue symbols to dense instrument ids, built once at startup
+ *
+ * The ids are given in the order of first appearance in the symbol list, duplicated symbols share the first id
+ * Lookup uses a perfect hash built with hash and displace: each symbol is hashed to a bucket,
+ * and each bucket gets a displacement seed so that all its symbols land in free slots of the table
+ * A lookup is two hashes and one string compare, no probing
+ */
+class SymbolDirectory {
+public:
+  explicit SymbolDirectory(const std::vector<std::string>& symbols);
+
+  // Number of instruments, the ids are in [0, size())
+  auto size() const -> std::size_t { return symbols_.size(); }
+
+  // Return kUnknownInstrument if the symbol is not in the directory
+  auto find(std::string_view symbol) const -> InstrumentId;
+
+  // Assume the id is valid
+  auto symbol(InstrumentId id) const -> const std::string& { return symbols_[id]; }
+
+private:
+  static auto hash(std::string_view symbol, std::uint64_t seed) -> std::uint64_t;
+
+  auto bucketOf(std::string_view symbol) const -> std::size_t {
+    return hash(symbol, 0) % displacements_.size();
+  }
+
+  auto slotOf(std::string_view symbol, std::uint32_t displacement) const -> std::size_t {
+    return hash(symbol, displacement) % slots_.size();
+  }
+
+  // Symbols indexed by instrument id
+  std::vector<std::string> symbols_;
+  // Displacement seed of each bucket
+  std::vector<std::uint32_t> displacements_;
+  // Instrument id in each slot of the table, kUnknownInstrument for a free slot
+  std::vector<InstrumentId> slots_;
+};
+
+} // namespace OrderBook
\ No newline at end of file
@@ -5,8 +5,8 @@ namespace OrderBook {
 
 struct Trade {
   Quantity quantity;
-  Price price;
-  Trade(Quantity qty, Price price) : quantity(qty), price(price) {}
+  Tick price;
+  Trade(Quantity qty, Tick price) : quantity(qty), price(price) {}
 };
 
 } // namespace OrderBook
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 namespace OrderBook {
 
-bool L2Book::existLevel(const bool is_sell, const Price price) const {
+bool L2Book::existLevel(const bool is_sell, const Tick price) const {
   if (is_sell) {
     return askBook_.find(price) != askBook_.end();
   } else {
@@ -12,7 +12,7 @@ bool L2Book::existLevel(const bool is_sell, const Price price) const {
   }
 }
 
-auto L2Book::getL2Level(const bool is_sell, const Price price) -> const L2PriceLevel &{
+auto L2Book::getL2Level(const bool is_sell, const Tick price) -> const L2PriceLevel &{
   if (is_sell) {
     return askBook_[price];
   } else {
@@ -21,7 +21,7 @@ auto L2Book::getL2Level(const bool is_sell, const Price price) -> const L2PriceL
 }
 
 
-void L2Book::addLevel(const bool is_sell, const Price price, const Quantity quantity){
+void L2Book::addLevel(const bool is_sell, const Tick price, const Quantity quantity){
   if (existLevel(is_sell, price)) {
     std::cerr << "[L2Book]: Trying to add an L2 level that already exist: "
               << quantity << "@" << quantity << std::endl;
@@ -32,32 +32,102 @@ void L2Book::addLevel(const bool is_sell, const Price price, const Quantity quan
   } else {
     bidBook_[price] = {price, quantity};
   }
+  ++version_;
 }
 
-void L2Book::updateLevel(const bool is_sell, const Price price, const Quantity quantity){
+void L2Book::updateLevel(const bool is_sell, const Tick price, const Quantity quantity){
   if (existLevel(is_sell, price)) {
     auto& level = is_sell ? askBook_[price]: bidBook_[price];
     level.price = price;
     level.quantity = quantity;
+    ++version_;
   }
 }
 
-void L2Book::removeLevel(const bool is_sell, const Price price){
+void L2Book::removeLevel(const bool is_sell, const Tick price){
   if (existLevel(is_sell, price)) {
     if (is_sell) {
       askBook_.erase(price);
     } else {
       bidBook_.erase(price);
     }
+    ++version_;
+  }
+}
+
+template <typename SideBook>
+static void setSideLevel(SideBook& side, const Tick price, const Quantity quantity) {
+  if (quantity == 0) {
+    side.erase(price);
+    return;
+  }
+  auto& level = side[price];
+  level.price = price;
+  level.quantity = quantity;
+}
+
+void L2Book::setLevel(const bool is_sell, const Tick price, const Quantity quantity) {
+  if (is_sell) {
+    setSideLevel(askBook_, price, quantity);
+  } else {
+    setSideLevel(bidBook_, price, quantity);
+  }
+  ++version_;
+}
+
+template <typename SideBook>
+static void diffSide(const SideBook& from, const SideBook& to, const bool is_sell, L2DeltaVec& deltas) {
+  auto comp = typename SideBook::key_compare();
+  auto lhs = from.begin();
+  auto rhs = to.begin();
+  while (lhs != from.end() || rhs != to.end()) {
+    if (rhs == to.end() || (lhs != from.end() && comp(levelOf(*lhs).price, levelOf(*rhs).price))) {
+      // Only in the current book
+      deltas.push_back({L2DeltaType::REMOVE, is_sell, levelOf(*lhs).price, 0});
+      ++lhs;
+    } else if (lhs == from.end() || comp(levelOf(*rhs).price, levelOf(*lhs).price)) {
+      // Only in the target book
+      deltas.push_back({L2DeltaType::ADD, is_sell, levelOf(*rhs).price, levelOf(*rhs).quantity});
+      ++rhs;
+    } else {
+      if (levelOf(*lhs).quantity != levelOf(*rhs).quantity) {
+        deltas.push_back({L2DeltaType::UPDATE, is_sell, levelOf(*rhs).price, levelOf(*rhs).quantity});
+      }
+      ++lhs;
+      ++rhs;
+    }
+  }
+}
+
+void L2Book::diff(const L2Book& target, L2DeltaVec& deltas) const {
+  diffSide(askBook_, target.askBook_, true, deltas);
+  diffSide(bidBook_, target.bidBook_, false, deltas);
+}
+
+void L2Book::apply(Span<const L2Delta> deltas) {
+  for (const auto& delta: deltas) {
+    switch (delta.type) {
+      case L2DeltaType::ADD:
+        addLevel(delta.is_sell, delta.price, delta.quantity);
+        break;
+      case L2DeltaType::UPDATE:
+        updateLevel(delta.is_sell, delta.price, delta.quantity);
+        break;
+      case L2DeltaType::REMOVE:
+        removeLevel(delta.is_sell, delta.price);
+        break;
+    }
   }
 }
 
 std::ostream& operator<<(std::ostream& os, const L2Book& book){
   for (auto iter = book.askBook_.rbegin(); iter != book.askBook_.rend(); ++iter) {
-    os << "A " << iter->second;
+    os << "A ";
+    levelOf(*iter).print(os, book.tick_size_);
   }
   for (auto iter = book.bidBook_.begin(); iter != book.bidBook_.end(); ++iter) {
-    os << "B " << iter->second;
+    os << "B ";
+    levelOf(*iter).print(os, book.tick_size_);
   }
   return os;
 }
@@ -4,49 +4,54 @@
 
 namespace OrderBook {
 
-auto L3PriceLevel::addOrder(const OrderPtr& order) -> OrderListIter {
+void L3PriceLevel::addOrder(Order* order) {
   quantity += order->getRemainingQuantity();
   price = order->price;
   num_orders += 1;
   orders.push_back(order);
-  auto iter = orders.end();
-  std::advance(iter, -1);
-  return iter;
 }
 
-void L3PriceLevel::removeOrder(const OrderHandler &handler){
-  orders.erase(handler.iter);
-  quantity -= handler.order->getRemainingQuantity();
+void L3PriceLevel::removeOrder(Order* order){
+  orders.erase(order);
+  quantity -= order->getRemainingQuantity();
   num_orders -= 1;
 }
 
-void L3PriceLevel::modifyOrder(OrderPtr order, const Quantity new_quantity, const Price new_price){
-  assert(new_price == order->price);
-  quantity += new_quantity - order->quantity;
-  order->quantity = new_quantity;
+void L3PriceLevel::modifyOrder(Order& order, const Quantity new_quantity, const Tick new_price){
+  assert(new_price == order.price);
+  quantity += new_quantity - order.quantity;
+  order.quantity = new_quantity;
 }
 
-void L3PriceLevel::fillOrder(OrderPtr order, Quantity qty){
-  assert(qty <= order->getRemainingQuantity());
-  order->filled_quantity += qty;
+void L3PriceLevel::fillOrder(Order& order, Quantity qty){
+  assert(qty <= order.getRemainingQuantity());
+  order.filled_quantity += qty;
   quantity -= qty;
 }
 
 
+void L2PriceLevel::print(std::ostream& os, const TickSize& tick_size) const {
+  os << "L2: " << quantity << "@"
+     << std::fixed << std::setprecision(2) << tick_size.toPrice(price) << std::endl;
+}
+
 std::ostream& operator<<(std::ostream& os, const L2PriceLevel& level) {
-  os << "L2: " << level.quantity << "@"
-     << std::fixed << std::setprecision(2) << level.price << std::endl;
+  level.print(os, kDefaultTickSize);
   return os;
 }
 
-std::ostream& operator<<(std::ostream& os, const L3PriceLevel& level) {
-  os << "L3: " << level.quantity << "@"
-     << std::fixed << std::setprecision(2) << level.price << std::endl;
+void L3PriceLevel::print(std::ostream& os, const TickSize& tick_size) const {
+  os << "L3: " << quantity << "@"
+     << std::fixed << std::setprecision(2) << tick_size.toPrice(price) << std::endl;
   os << "Orders:(";
-  for (auto& order: level.orders) {
-    os << (*order);
+  for (const auto& order: orders) {
+    order.print(os, tick_size);
   }
   os << ")" << std::endl;
+}
+
+std::ostream& operator<<(std::ostream& os, const L3PriceLevel& level) {
+  level.print(os, kDefaultTickSize);
   return os;
 }
 
@@ -3,10 +3,14 @@
 
 namespace OrderBook {
 
-std::ostream & operator<<(std::ostream &os, const Order &order){
+void Order::print(std::ostream& os, const TickSize& tick_size) const {
   // Ouput the order with details. The precisiou is fixed to 2
-  os << "[" << order.odid << ", "  << order.quantity << "@"
-     << std::fixed << std::setprecision(2) << order.price << "]";
+  os << "[" << odid << ", "  << quantity << "@"
+     << std::fixed << std::setprecision(2) << tick_size.toPrice(price) << "]";
+}
+
+std::ostream & operator<<(std::ostream &os, const Order &order){
+  order.print(os, kDefaultTickSize);
   return os;
 }
 
@@ -0,0 +1,24 @@
+#include "order_pool.h"
+
+namespace OrderBook {
+
+OrderPool::OrderPool(std::size_t initial_capacity)
+  : next_slab_size_(initial_capacity > 0 ? initial_capacity : 1) {
+  grow();
+}
+
+void OrderPool::grow() {
+  auto slab_size = next_slab_size_;
+  slabs_.emplace_back(new Slot[slab_size]);
+  capacity_ += slab_size;
+  // Reserve for all the slots so that giving back an order never allocates
+  free_slots_.reserve(capacity_);
+  auto slab = slabs_.back().get();
+  // Push in reverse order so that the orders are handed out from the beginning of the slab
+  for (std::size_t i = slab_size; i > 0; --i) {
+    free_slots_.push_back(&slab[i - 1]);
+  }
+  next_slab_size_ = capacity_;
+}
+
+} // namespace OrderBook
\ No newline at end of file
@@ -0,0 +1,21 @@
+#include "sharded_book_manager.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace OrderBook {
+
+bool pinCurrentThread(int core) {
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(core, &cpu_set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0;
+#else
+  (void)core;
+  return false;
+#endif
+}
+
+} // namespace OrderBook
\ No newline at end of file
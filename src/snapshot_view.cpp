@@ -0,0 +1,33 @@
+#include "snapshot_view.h"
+
+namespace OrderBook {
+
+namespace {
+
+template <typename T>
+void store(std::vector<std::byte>& buffer, const T value) {
+  auto offset = buffer.size();
+  buffer.resize(offset + sizeof(T));
+  std::memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+void encodeSide(const L2SnapshotSide& side, std::vector<std::byte>& buffer) {
+  store(buffer, static_cast<std::uint32_t>(side.size()));
+  for (const auto& level: side) {
+    store(buffer, level.price);
+    store(buffer, level.quantity);
+  }
+}
+
+} // namespace
+
+void encodeSnapshot(const SnapshotMessage& msg, std::vector<std::byte>& buffer) {
+  buffer.reserve(buffer.size() + SnapshotWire::kHeaderBytes + 2 * SnapshotWire::kCountBytes +
+                 (msg.bid_levels.size() + msg.ask_levels.size()) * SnapshotWire::kLevelBytes);
+  store(buffer, msg.instrument);
+  store(buffer, msg.timestamp);
+  encodeSide(msg.bid_levels, buffer);
+  encodeSide(msg.ask_levels, buffer);
+}
+
+} // namespace OrderBook
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "spsc_ring.h"
+#include <thread>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace OrderBook {
+
+void futexWait(std::atomic<std::uint32_t>& word, std::uint32_t expected) {
+#ifdef __linux__
+  // Returns right away if the word doesn't hold the expected value anymore
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+#else
+  while (word.load(std::memory_order_acquire) == expected) std::this_thread::yield();
+#endif
+}
+
+void futexWakeAll(std::atomic<std::uint32_t>& word) {
+#ifdef __linux__
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT32_MAX, nullptr, nullptr, 0);
+#else
+  (void)word;
+#endif
+}
+
+void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+} // namespace OrderBook
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "symbol_directory.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
+namespace OrderBook {
+
+SymbolDirectory::SymbolDirectory(const std::vector<std::string>& symbols) {
+  // Give the dense ids, the duplicated symbols keep the first id
+  std::unordered_set<std::string_view> known_symbols;
+  for (const auto& symbol: symbols) {
+    if (known_symbols.insert(symbol).second) symbols_.push_back(symbol);
+  }
+
+  // About 4 symbols per bucket and a load factor of 0.8 for the table
+  auto num_symbols = symbols_.size();
+  displacements_.assign(num_symbols / 4 + 1, 0);
+  slots_.assign(num_symbols + num_symbols / 4 + 1, kUnknownInstrument);
+
+  std::vector<std::vector<InstrumentId>> buckets(displacements_.size());
+  for (InstrumentId id = 0; id < num_symbols; ++id) {
+    buckets[bucketOf(symbols_[id])].push_back(id);
+  }
+  // Place the largest buckets first while the table is still empty
+  std::vector<std::size_t> bucket_order(buckets.size());
+  std::iota(bucket_order.begin(), bucket_order.end(), 0);
+  std::stable_sort(bucket_order.begin(), bucket_order.end(), [&buckets](std::size_t lhs, std::size_t rhs) {
+    return buckets[lhs].size() > buckets[rhs].size();
+  });
+
+  std::vector<std::size_t> bucket_slots;
+  for (auto bucket: bucket_order) {
+    if (buckets[bucket].empty()) break;
+    // Try the displacements until all the symbols of the bucket land in distinct free slots
+    for (std::uint32_t displacement = 1;; ++displacement) {
+      bucket_slots.clear();
+      bool placed = true;
+      for (auto id: buckets[bucket]) {
+        auto slot = slotOf(symbols_[id], displacement);
+        if (slots_[slot] != kUnknownInstrument ||
+            std::find(bucket_slots.begin(), bucket_slots.end(), slot) != bucket_slots.end()) {
+          placed = false;
+          break;
+        }
+        bucket_slots.push_back(slot);
+      }
+      if (!placed) continue;
+      for (std::size_t i = 0; i < bucket_slots.size(); ++i) {
+        slots_[bucket_slots[i]] = buckets[bucket][i];
+      }
+      displacements_[bucket] = displacement;
+      break;
+    }
+  }
+}
+
+auto SymbolDirectory::find(std::string_view symbol) const -> InstrumentId {
+  auto id = slots_[slotOf(symbol, displacements_[bucketOf(symbol)])];
+  if (id == kUnknownInstrument || symbols_[id] != symbol) return kUnknownInstrument;
+  return id;
+}
+
+auto SymbolDirectory::hash(std::string_view symbol, std::uint64_t seed) -> std::uint64_t {
+  // FNV-1a seeded with the displacement, then the splitmix64 finalizer
+  std::uint64_t x = 0xCBF29CE484222325ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+  for (auto c: symbol) {
+    x ^= static_cast<unsigned char>(c);
+    x *= 0x100000001B3ULL;
+  }
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+} // namespace OrderBook
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "book_manager.h"
+#include "snapshot_view.h"
+#include "symbol_directory.h"
+
+namespace {
+using namespace OrderBook;
+
+// Convert the venue price to ticks as a decoder does
+Tick px(Price price) { return kDefaultTickSize.toTick(price); }
+
+// Static listener, the calls are resolved at compile time
+struct RecordingListener {
+  void onOrderAdd(SmartOrderBook&, const OrderInfo& info) { events.push_back(info); }
+  void onOrderCancel(SmartOrderBook&, const OrderInfo& info) { events.push_back(info); }
+  void onOrderModify(SmartOrderBook&, const OrderInfo& info) { events.push_back(info); }
+  void onOrderExecution(SmartOrderBook& book, const OrderInfo& info) {
+    events.push_back(info);
+    // The book is already updated when the event is delivered
+    book_has_order = book.existOrder(info.odid);
+  }
+
+  std::vector<OrderInfo> events;
+  bool book_has_order{true};
+};
+
+// Virtual listener counting the events
+class CountingListener : public OrderEventListener {
+public:
+  void onOrderAdd(SmartOrderBook&, const OrderInfo&) override { ++adds; }
+  void onOrderCancel(SmartOrderBook&, const OrderInfo&) override { ++cancels; }
+  void onOrderModify(SmartOrderBook&, const OrderInfo&) override { ++modifies; }
+  void onOrderExecution(SmartOrderBook&, const OrderInfo&) override { ++executions; }
+
+  int adds{0};
+  int cancels{0};
+  int modifies{0};
+  int executions{0};
+};
+
+TEST(BookManagerTest, staticListenerTest) {
+  RecordingListener listener;
+  BookManager<RecordingListener> manager(listener);
+  manager.processOrderMessage({MessageType::ADD, 1, true, 10, px(101)});
+  ASSERT_EQ(listener.events.size(), 1);
+  EXPECT_TRUE(listener.events[0] == OrderInfo(OrderEvent::ADD, 1, true, 10, px(101)));
+
+  // The aggressive order fills the resting order, the events are delivered right after the message
+  manager.processOrderMessage({MessageType::ADD, 2, false, 15, px(101)});
+  ASSERT_EQ(listener.events.size(), 3);
+  EXPECT_TRUE(listener.events[1] == OrderInfo(OrderEvent::EXEC, 1, true, 10, px(101)));
+  EXPECT_TRUE(listener.events[2] == OrderInfo(OrderEvent::ADD, 2, false, 5, px(101)));
+  EXPECT_FALSE(listener.book_has_order);
+}
+
+TEST(BookManagerTest, inlineBatchTest) {
+  // The listener is called as each event is emitted, not at the end of the batch
+  struct BookStateListener {
+    void onOrderAdd(SmartOrderBook& book, const OrderInfo& info) {
+      events.push_back(info);
+      orders_in_book.push_back(book.existOrder(1) + book.existOrder(2));
+    }
+    void onOrderCancel(SmartOrderBook&, const OrderInfo& info) { events.push_back(info); }
+    void onOrderModify(SmartOrderBook&, const OrderInfo& info) { events.push_back(info); }
+    void onOrderExecution(SmartOrderBook&, const OrderInfo& info) { events.push_back(info); }
+
+    std::vector<OrderInfo> events;
+    std::vector<int> orders_in_book;
+  };
+  BookStateListener listener;
+  BookManager<BookStateListener> manager(listener);
+  std::vector<BookMessage> msgs = {
+    OrderMessage{MessageType::ADD, 1, true, 10, px(101)},
+    OrderMessage{MessageType::ADD, 2, true, 10, px(102)},
+  };
+  manager.processBatch(msgs);
+  ASSERT_EQ(listener.events.size(), 2);
+  EXPECT_EQ(listener.orders_in_book, std::vector<int>({1, 2}));
+}
+
+TEST(BookManagerTest, virtualListenerTest) {
+  CountingListener listener;
+  BookManager<> manager(listener);
+  manager.processOrderMessage({MessageType::ADD, 1, true, 10, px(101)});
+  manager.processOrderMessage({MessageType::MODIFY, 1, true, 20, px(101)});
+  manager.processOrderMessage({MessageType::CANCEL, 1, true, 20, px(101)});
+  manager.processTradeMessage({10, px(100)});
+  EXPECT_EQ(listener.adds, 3);
+  EXPECT_EQ(listener.modifies, 1);
+  EXPECT_EQ(listener.cancels, 1);
+  EXPECT_EQ(listener.executions, 2);
+  EXPECT_FALSE(manager.book().existOrder(1));
+}
+
+TEST(BookManagerTest, multiInstrumentTest) {
+  SymbolDirectory directory({"AAPL", "MSFT", "GOOG"});
+  RecordingListener listener;
+  BookManager<RecordingListener> manager(listener, directory.size());
+  EXPECT_EQ(manager.numInstruments(), 3);
+
+  auto msft = directory.find("MSFT");
+  auto goog = directory.find("GOOG");
+  manager.processOrderMessage({MessageType::ADD, 1, true, 10, px(101), msft});
+  manager.processOrderMessage({MessageType::ADD, 1, false, 10, px(101), goog});
+  // The orders are on different books, so they don't cross
+  EXPECT_EQ(listener.events.size(), 2);
+  EXPECT_TRUE(manager.book(msft).existOrder(1));
+  EXPECT_TRUE(manager.book(goog).existOrder(1));
+  EXPECT_FALSE(manager.book(directory.find("AAPL")).existOrder(1));
+
+  // The trade only fills the order on its book
+  manager.processTradeMessage({10, px(101), msft});
+  EXPECT_TRUE(listener.events.back() == OrderInfo(OrderEvent::EXEC, 1, true, 10, px(101)));
+  EXPECT_FALSE(manager.book(msft).existOrder(1));
+  EXPECT_TRUE(manager.book(goog).existOrder(1));
+}
+
+TEST(BookManagerTest, ringTest) {
+  // The decoder thread feeds the book thread through the ring
+  RecordingListener listener;
+  BookManager<RecordingListener> manager(listener);
+  SpscRing<BookMessage> ring(8, WaitMode::BLOCKING);
+  std::thread decoder([&ring] {
+    for (OrderId id = 0; id < 100; ++id) {
+      BookMessage msg = OrderMessage{MessageType::ADD, id, true, 10, px(101)};
+      while (!ring.tryPush(std::move(msg))) std::this_thread::yield();
+    }
+    BookMessage snapshot = SnapshotMessage{{}, {{px(101), 990}}};
+    while (!ring.tryPush(std::move(snapshot))) std::this_thread::yield();
+    ring.close();
+  });
+  manager.run(ring);
+  decoder.join();
+  ASSERT_EQ(listener.events.size(), 101);
+  EXPECT_TRUE(listener.events.back() == OrderInfo(OrderEvent::EXEC, 0, true, 10, px(101)));
+  EXPECT_FALSE(manager.book().existOrder(0));
+  EXPECT_TRUE(manager.book().existOrder(99));
+}
+
+TEST(BookManagerTest, reorderTest) {
+  // The trade stream leads the order stream, the reorder window puts the order first
+  RecordingListener listener;
+  BookManager<RecordingListener> manager(listener, 1, 1000);
+  manager.ingest(OrderMessage{MessageType::ADD, 1, true, 10, px(101), 0, 1000});
+  manager.ingest(TradeMessage(10, px(100), 0, 1200));
+  manager.ingest(OrderMessage{MessageType::ADD, 2, false, 10, px(100), 0, 1100});
+  manager.ingest(OrderMessage{MessageType::ADD, 3, true, 10, px(100), 0, 1150});
+  manager.flushReorderBuffer();
+  // The order 3 is filled by the order 2 and the trade is expected, so nothing is guessed
+  ASSERT_EQ(listener.events.size(), 3);
+  EXPECT_TRUE(listener.events[1] == OrderInfo(OrderEvent::ADD, 2, false, 10, px(100)));
+  EXPECT_TRUE(listener.events[2] == OrderInfo(OrderEvent::EXEC, 2, false, 10, px(100)));
+  EXPECT_FALSE(manager.book().existOrder(2));
+  EXPECT_TRUE(manager.book().existOrder(1));
+}
+
+TEST(BookManagerTest, idleFeedTest) {
+  // On an idle feed, the held messages are released after the reorder window, before any other message comes
+  struct AddCounter {
+    void onOrderAdd(SmartOrderBook&, const OrderInfo&) { ++adds; }
+    void onOrderCancel(SmartOrderBook&, const OrderInfo&) {}
+    void onOrderModify(SmartOrderBook&, const OrderInfo&) {}
+    void onOrderExecution(SmartOrderBook&, const OrderInfo&) {}
+
+    std::atomic<int> adds{0};
+  };
+  AddCounter listener;
+  // 1 ms window
+  BookManager<AddCounter> manager(listener, 1, 1000000);
+  SpscRing<BookMessage> ring(8, WaitMode::BLOCKING);
+  bool released_before_close = false;
+  std::thread decoder([&ring, &listener, &released_before_close] {
+    BookMessage msg = OrderMessage{MessageType::ADD, 1, true, 10, px(101), 0, 1000};
+    while (!ring.tryPush(std::move(msg))) std::this_thread::yield();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (listener.adds.load() == 0 && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+    released_before_close = listener.adds.load() == 1;
+    ring.close();
+  });
+  manager.run(ring);
+  decoder.join();
+  EXPECT_TRUE(released_before_close);
+  EXPECT_TRUE(manager.book().existOrder(1));
+}
+
+TEST(BookManagerTest, batchTest) {
+  // The runs of each instrument are processed as one batch of its book
+  RecordingListener listener;
+  BookManager<RecordingListener> manager(listener, 2);
+  std::vector<BookMessage> msgs = {
+    OrderMessage{MessageType::ADD, 1, true, 10, px(101), 0},
+    OrderMessage{MessageType::ADD, 2, true, 10, px(101), 1},
+    OrderMessage{MessageType::ADD, 3, false, 10, px(101), 1},
+    TradeMessage(10, px(101), 1),
+  };
+  manager.processBatch(msgs);
+  ASSERT_EQ(listener.events.size(), 3);
+  EXPECT_TRUE(listener.events[0] == OrderInfo(OrderEvent::ADD, 1, true, 10, px(101)));
+  EXPECT_TRUE(listener.events[1] == OrderInfo(OrderEvent::ADD, 2, true, 10, px(101)));
+  EXPECT_TRUE(listener.events[2] == OrderInfo(OrderEvent::EXEC, 2, true, 10, px(101)));
+  EXPECT_TRUE(manager.book(0).existOrder(1));
+  EXPECT_FALSE(manager.book(1).existOrder(2));
+}
+
+TEST(BookManagerTest, bookConfigTest) {
+  // Each instrument has its own tick size, snapshot mode and capacities
+  RecordingListener listener;
+  std::vector<BookConfig> configs(2);
+  configs[1].tick_size = TickSize(0.5);
+  configs[1].snapshot_mode = SnapshotMode::PER_MESSAGE;
+  configs[1].snapshot_depth = 5;
+  configs[1].capacity.orders = 16;
+  BookManager<RecordingListener> manager(listener, configs);
+  EXPECT_EQ(manager.numInstruments(), 2);
+  EXPECT_EQ(manager.book(0).tickSize().size, 0.01);
+  EXPECT_EQ(manager.book(0).snapshotMode(), SnapshotMode::PER_FILL);
+  EXPECT_EQ(manager.book(0).snapshotDepth(), 0);
+  EXPECT_EQ(manager.book(1).tickSize().size, 0.5);
+  EXPECT_EQ(manager.book(1).snapshotMode(), SnapshotMode::PER_MESSAGE);
+  EXPECT_EQ(manager.book(1).snapshotDepth(), 5);
+  // The books are stored contiguously
+  EXPECT_EQ(&manager.book(1), &manager.book(0) + 1);
+
+  manager.processOrderMessage({MessageType::ADD, 1, true, 10, 202, 1});
+  EXPECT_TRUE(manager.book(1).existOrder(1));
+  EXPECT_FALSE(manager.book(0).existOrder(1));
+}
+
+TEST(BookManagerTest, batchAfterIngestTest) {
+  // The messages held in the reorder buffer are processed before the batch
+  RecordingListener listener;
+  BookManager<RecordingListener> manager(listener, 1, 1000);
+  manager.ingest(OrderMessage{MessageType::ADD, 1, true, 10, px(101), 0, 1000});
+  std::vector<BookMessage> msgs = {OrderMessage{MessageType::ADD, 2, false, 10, px(101), 0, 1100}};
+  manager.processBatch(msgs);
+  ASSERT_EQ(listener.events.size(), 2);
+  EXPECT_TRUE(listener.events[0] == OrderInfo(OrderEvent::ADD, 1, true, 10, px(101)));
+  EXPECT_TRUE(listener.events[1] == OrderInfo(OrderEvent::EXEC, 1, true, 10, px(101)));
+  EXPECT_FALSE(manager.book().existOrder(1));
+  EXPECT_FALSE(manager.book().existOrder(2));
+}
+
+TEST(BookManagerTest, unknownInstrumentTest) {
+  // The messages of an unknown instrument are dropped and counted
+  RecordingListener listener;
+  BookManager<RecordingListener> manager(listener, 2);
+  manager.processOrderMessage({MessageType::ADD, 1, true, 10, px(101), kUnknownInstrument});
+  manager.processTradeMessage({10, px(101), 2});
+  manager.processSnapshotMessage(SnapshotMessage{{}, {{px(101), 10}}, 5});
+  std::vector<BookMessage> msgs = {
+    OrderMessage{MessageType::ADD, 1, true, 10, px(101), 0},
+    OrderMessage{MessageType::ADD, 2, true, 10, px(101), 7},
+    OrderMessage{MessageType::ADD, 3, true, 10, px(101), 7},
+  };
+  manager.processBatch(msgs);
+  EXPECT_EQ(manager.droppedMessageCount(), 5);
+  ASSERT_EQ(listener.events.size(), 1);
+  EXPECT_TRUE(manager.book(0).existOrder(1));
+  EXPECT_FALSE(manager.book(1).existOrder(1));
+}
+
+TEST(BookManagerTest, snapshotViewInstrumentTest) {
+  // The instrument id of a snapshot view is read from the wire bytes
+  RecordingListener listener;
+  BookManager<RecordingListener> manager(listener, 2);
+  manager.processOrderMessage({MessageType::ADD, 1, true, 10, px(101), 1});
+  std::vector<std::byte> bad_instrument;
+  encodeSnapshot({{}, {{px(101), 5}}, 9}, bad_instrument);
+  manager.processSnapshotMessage(SnapshotView(bad_instrument));
+  std::vector<std::byte> truncated;
+  encodeSnapshot({{}, {{px(101), 5}}, 1}, truncated);
+  truncated.pop_back();
+  manager.processSnapshotMessage(SnapshotView(truncated));
+  EXPECT_EQ(manager.droppedMessageCount(), 2);
+  ASSERT_EQ(listener.events.size(), 1);
+
+  // The valid view of the instrument reconciles its book
+  std::vector<std::byte> valid;
+  encodeSnapshot({{}, {{px(101), 5}}, 1}, valid);
+  manager.processSnapshotMessage(SnapshotView(valid));
+  EXPECT_EQ(manager.droppedMessageCount(), 2);
+  EXPECT_TRUE(listener.events.back() == OrderInfo(OrderEvent::EXEC, 1, true, 5, px(101)));
+}
+
+}
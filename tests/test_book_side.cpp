@@ -5,17 +5,20 @@
 namespace {
 using namespace OrderBook;
 
+// Convert the venue price to ticks as a decoder does
+Tick px(Price price) { return kDefaultTickSize.toTick(price); }
+
 class BookSideTest : public ::testing::Test {
 protected:
   void SetUp() override {
     /*
      *  Construct with an initial book
      */
-    side_.addOrder(std::make_shared<Order>(1, true, 40, 104));
-    side_.addOrder(std::make_shared<Order>(2, true, 80, 103));
-    side_.addOrder(std::make_shared<Order>(3, true, 60, 102));
-    side_.addOrder(std::make_shared<Order>(4, true, 50, 101));
-    side_.addOrder(std::make_shared<Order>(5, true, 60, 100));
+    side_.addOrder(Order(1, true, 40, px(104)));
+    side_.addOrder(Order(2, true, 80, px(103)));
+    side_.addOrder(Order(3, true, 60, px(102)));
+    side_.addOrder(Order(4, true, 50, px(101)));
+    side_.addOrder(Order(5, true, 60, px(100)));
   }
 
   std::string getCurL2Book() {
@@ -27,7 +30,7 @@ protected:
   }
 
   // test with sell side
-  BookSide side_{true, AskComparator()};
+  BookSide<Ask> side_;
 };
 
 TEST_F(BookSideTest, initializationTest) {
@@ -42,7 +45,7 @@ TEST_F(BookSideTest, initializationTest) {
 
 TEST_F(BookSideTest, addOrderTest) {
   // Add a order with existing order id, won't change the book
-  side_.addOrder(std::make_shared<Order>(1, true, 10, 101));
+  side_.addOrder(Order(1, true, 10, px(101)));
   std::string expected_book =
     "A L2: 40@104.00\n"
     "A L2: 80@103.00\n"
@@ -50,7 +53,7 @@ TEST_F(BookSideTest, addOrderTest) {
     "A L2: 50@101.00\n"
     "A L2: 60@100.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
-  side_.addOrder(std::make_shared<Order>(6, true, 10, 101));
+  side_.addOrder(Order(6, true, 10, px(101)));
   expected_book =
     "A L2: 40@104.00\n"
     "A L2: 80@103.00\n"
@@ -59,7 +62,7 @@ TEST_F(BookSideTest, addOrderTest) {
     "A L2: 60@100.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_TRUE(side_.existOrder(6));
-  side_.addOrder(std::make_shared<Order>(7, true, 20, 105));
+  side_.addOrder(Order(7, true, 20, px(105)));
   expected_book =
     "A L2: 20@105.00\n" // New level 20@105
     "A L2: 40@104.00\n"
@@ -90,11 +93,14 @@ TEST_F(BookSideTest, removeOrderTest) {
     "A L2: 60@100.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_FALSE(side_.existOrder(1));
+  // The order is given back to the pool
+  EXPECT_EQ(side_.orderPool().size(), 4);
+  EXPECT_EQ(side_.orderPool().highWaterMark(), 5);
 }
 
 TEST_F(BookSideTest, modifyOrder) {
   // modify an invalid order, the book should be unchanged
-  side_.modifyOrder(10 , 20, 101);
+  side_.modifyOrder(10, 20, px(101));
   std::string expected_book =
     "A L2: 40@104.00\n"
     "A L2: 80@103.00\n"
@@ -104,7 +110,7 @@ TEST_F(BookSideTest, modifyOrder) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Modify an order without price change
-  side_.modifyOrder(1, 80, 104);
+  side_.modifyOrder(1, 80, px(104));
   expected_book =
     "A L2: 80@104.00\n" // 40@104 ==> 80@104
     "A L2: 80@103.00\n"
@@ -115,35 +121,40 @@ TEST_F(BookSideTest, modifyOrder) {
 
   // Modify an order with price change
   // 80@103 ==> 60@102
-  side_.modifyOrder(2, 60, 102);
+  auto high_water_mark = side_.orderPool().highWaterMark();
+  side_.modifyOrder(2, 60, px(102));
   expected_book =
     "A L2: 80@104.00\n"
     "A L2: 120@102.00\n"
     "A L2: 50@101.00\n"
     "A L2: 60@100.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
+  // The same order is moved to the new level
+  EXPECT_EQ(side_.orderPool().highWaterMark(), high_water_mark);
+  EXPECT_EQ(side_.getOrderHandler(2).level->price, px(102));
+  EXPECT_EQ(&side_.getL3Level(px(102)).orders.back(), side_.getOrderHandler(2).order);
 }
 
 TEST_F(BookSideTest, bookCrossedWithPriceTest) {
-  EXPECT_TRUE(side_.bookCrossedWithPrice(100));
-  EXPECT_TRUE(side_.bookCrossedWithPrice(101));
-  EXPECT_TRUE(side_.bookCrossedWithPrice(102));
-  EXPECT_FALSE(side_.bookCrossedWithPrice(99));
-  EXPECT_FALSE(side_.bookCrossedWithPrice(98));
-  EXPECT_FALSE(side_.bookCrossedWithPrice(10));
+  EXPECT_TRUE(side_.bookCrossedWithPrice(px(100)));
+  EXPECT_TRUE(side_.bookCrossedWithPrice(px(101)));
+  EXPECT_TRUE(side_.bookCrossedWithPrice(px(102)));
+  EXPECT_FALSE(side_.bookCrossedWithPrice(px(99)));
+  EXPECT_FALSE(side_.bookCrossedWithPrice(px(98)));
+  EXPECT_FALSE(side_.bookCrossedWithPrice(px(10)));
 }
 
 TEST_F(BookSideTest, existLevelTest) {
-  EXPECT_TRUE(side_.existLevel(100));
-  EXPECT_TRUE(side_.existLevel(104));
-  EXPECT_FALSE(side_.existLevel(99));
-  EXPECT_FALSE(side_.existLevel(96));
+  EXPECT_TRUE(side_.existLevel(px(100)));
+  EXPECT_TRUE(side_.existLevel(px(104)));
+  EXPECT_FALSE(side_.existLevel(px(99)));
+  EXPECT_FALSE(side_.existLevel(px(96)));
 }
 
 TEST_F(BookSideTest, getLevelTest) {
-  auto& level = side_.getL3Level(100);
+  auto& level = side_.getL3Level(px(100));
   EXPECT_EQ(level.quantity, 60);
-  EXPECT_EQ(level.price, 100);
+  EXPECT_EQ(level.price, px(100));
   EXPECT_EQ(level.num_orders, 1);
 }
 
@@ -157,7 +168,7 @@ TEST_F(BookSideTest, orderSteamLeadTest1) {
    */
   // Send a buy order 100@102
   // Will get two trade 60@100, 40@101
-  auto aggressor = std::make_shared<Order>(6, false, 100, 102);
+  Order aggressor(6, false, 100, px(102));
   auto events = side_.processCrossedOrder(aggressor);
   std::string expected_book =
     "A L2: 40@104.00\n"
@@ -166,9 +177,9 @@ TEST_F(BookSideTest, orderSteamLeadTest1) {
     "A L2: 10@101.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 2);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 60, 100));
-  EXPECT_TRUE(events[1] == OrderInfo(OrderEvent::EXEC, 4, true, 40, 101));
-  EXPECT_EQ(aggressor->getRemainingQuantity(), 0);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 60, px(100)));
+  EXPECT_TRUE(events[1] == OrderInfo(OrderEvent::EXEC, 4, true, 40, px(101)));
+  EXPECT_EQ(aggressor.getRemainingQuantity(), 0);
   EXPECT_FALSE(side_.existOrder(5));
   EXPECT_TRUE(side_.existOrder(4));
   auto& order = side_.getOrderHandler(4).order;
@@ -186,7 +197,7 @@ TEST_F(BookSideTest, orderSteamLeadTest2) {
    */
   // Send a buy order 100@100
   // Will get a trade 60@100 with 40 remaining qty
-  auto aggressor = std::make_shared<Order>(6, false, 100, 100);
+  Order aggressor(6, false, 100, px(100));
   auto events = side_.processCrossedOrder(aggressor);
   std::string expected_book =
     "A L2: 40@104.00\n"
@@ -195,8 +206,8 @@ TEST_F(BookSideTest, orderSteamLeadTest2) {
     "A L2: 50@101.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 1);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 60, 100));
-  EXPECT_EQ(aggressor->getRemainingQuantity(), 40);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 60, px(100)));
+  EXPECT_EQ(aggressor.getRemainingQuantity(), 40);
   EXPECT_FALSE(side_.existOrder(5));
 }
 
@@ -212,8 +223,8 @@ TEST_F(BookSideTest, orderSteamLeadTest3) {
   // Add 2 new orders  20@100, 30@100
   // Then there are 3 order with price 100.  60@100, 20@100, 30@100
   // When an aggressive order 90@100 arrives, 3 trade 60@100, 20@100, 20@100 are expected
-  side_.addOrder(std::make_shared<Order>(6, true, 20, 100));
-  side_.addOrder(std::make_shared<Order>(7, true, 30, 100));
+  side_.addOrder(Order(6, true, 20, px(100)));
+  side_.addOrder(Order(7, true, 30, px(100)));
   std::string expected_book =
     "A L2: 40@104.00\n"
     "A L2: 80@103.00\n"
@@ -223,7 +234,7 @@ TEST_F(BookSideTest, orderSteamLeadTest3) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive an aggressive order 90@100
-  auto aggressor = std::make_shared<Order>(8, false, 90, 100);
+  Order aggressor(8, false, 90, px(100));
   auto events = side_.processCrossedOrder(aggressor);
   expected_book =
     "A L2: 40@104.00\n"
@@ -233,13 +244,13 @@ TEST_F(BookSideTest, orderSteamLeadTest3) {
     "A L2: 20@100.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 3);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 60, 100));
-  EXPECT_TRUE(events[1] == OrderInfo(OrderEvent::EXEC, 6, true, 20, 100));
-  EXPECT_TRUE(events[2] == OrderInfo(OrderEvent::EXEC, 7, true, 10, 100));
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 60, px(100)));
+  EXPECT_TRUE(events[1] == OrderInfo(OrderEvent::EXEC, 6, true, 20, px(100)));
+  EXPECT_TRUE(events[2] == OrderInfo(OrderEvent::EXEC, 7, true, 10, px(100)));
   EXPECT_FALSE(side_.existOrder(5));
   EXPECT_FALSE(side_.existOrder(6));
   EXPECT_TRUE(side_.existOrder(7));
-  EXPECT_EQ(aggressor->getRemainingQuantity(), 0);
+  EXPECT_EQ(aggressor.getRemainingQuantity(), 0);
 }
 
 TEST_F(BookSideTest, orderSteamLeadTest4) {
@@ -253,8 +264,8 @@ TEST_F(BookSideTest, orderSteamLeadTest4) {
   // Send a buy order, the initial qty is 100, but filled qty if 80, Remaining qty 20
   // Will have the same effect as an order 20@100
   // Will get two trade 60@100, 40@101
-  auto aggressor = std::make_shared<Order>(6, false, 100, 102);
-  aggressor->filled_quantity = 80;
+  Order aggressor(6, false, 100, px(102));
+  aggressor.filled_quantity = 80;
   auto events = side_.processCrossedOrder(aggressor);
   std::string expected_book =
     "A L2: 40@104.00\n"
@@ -264,8 +275,8 @@ TEST_F(BookSideTest, orderSteamLeadTest4) {
     "A L2: 40@100.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 1);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 20, 100));
-  EXPECT_EQ(aggressor->getRemainingQuantity(), 0);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 20, px(100)));
+  EXPECT_EQ(aggressor.getRemainingQuantity(), 0);
   EXPECT_TRUE(side_.existOrder(5));
   auto& order = side_.getOrderHandler(5).order;
   EXPECT_EQ(order->getRemainingQuantity(), 40);
@@ -281,7 +292,7 @@ TEST_F(BookSideTest, tradeStreamLeadTest1) {
     "A L2: 60@100.00\n";
    */
   // Get a trade 20@100
-  Trade trade{20, 100};
+  Trade trade{20, px(100)};
   auto events = side_.processTrade(trade);
   std::string expected_book =
     "A L2: 40@104.00\n"
@@ -292,7 +303,7 @@ TEST_F(BookSideTest, tradeStreamLeadTest1) {
   // Expect order execution event 20@100
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 1);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 20, 100));
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 20, px(100)));
 }
 
 TEST_F(BookSideTest, tradeSteamLeadTest2) {
@@ -303,7 +314,7 @@ TEST_F(BookSideTest, tradeSteamLeadTest2) {
     "A L2: 50@101.00\n"
     "A L2: 60@100.00\n";  <= Received a trade 20@100
    */
-  Trade trade{20, 100};
+  Trade trade{20, px(100)};
   auto events = side_.processTrade(trade);
   std::string expected_book =
     "A L2: 40@104.00\n"
@@ -314,7 +325,7 @@ TEST_F(BookSideTest, tradeSteamLeadTest2) {
   // Expect order execution event 20@100
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 1);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 20, 100));
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 5, true, 20, px(100)));
 }
 
 TEST_F(BookSideTest, tradeSteamLeadTest3) {
@@ -325,7 +336,7 @@ TEST_F(BookSideTest, tradeSteamLeadTest3) {
     "A L2: 50@101.00\n"
     "A L2: 60@100.00\n";
    */
-  Trade trade{20, 102};
+  Trade trade{20, px(102)};
   auto events = side_.processTrade(trade);
   std::string expected_book =
     "A L2: 40@104.00\n"
@@ -333,21 +344,21 @@ TEST_F(BookSideTest, tradeSteamLeadTest3) {
     "A L2: 40@102.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 3);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::CANCEL, 5, true, 60, 100));
-  EXPECT_TRUE(events[1] == OrderInfo(OrderEvent::CANCEL, 4, true, 50, 101));
-  EXPECT_TRUE(events[2] == OrderInfo(OrderEvent::EXEC, 3, true, 20, 102));
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::CANCEL, 5, true, 60, px(100)));
+  EXPECT_TRUE(events[1] == OrderInfo(OrderEvent::CANCEL, 4, true, 50, px(101)));
+  EXPECT_TRUE(events[2] == OrderInfo(OrderEvent::EXEC, 3, true, 20, px(102)));
   EXPECT_FALSE(side_.existOrder(5));
   EXPECT_FALSE(side_.existOrder(4));
   EXPECT_TRUE(side_.existOrder(3));
 
   // The order cancel messages that arrive late should not change the order book
-  side_.processOrderCancel(4, 50, 101);
+  side_.processOrderCancel(4, 50, px(101));
   expected_book =
     "A L2: 40@104.00\n"
     "A L2: 80@103.00\n"
     "A L2: 40@102.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
-  side_.processOrderCancel(5, 60, 100);
+  side_.processOrderCancel(5, 60, px(100));
   expected_book =
     "A L2: 40@104.00\n"
     "A L2: 80@103.00\n"
@@ -365,7 +376,7 @@ TEST_F(BookSideTest, tradeSteamLeadTest4) {
 
                          <== Receive a trade 30@99
    */
-  Trade trade{30, 99};
+  Trade trade{30, px(99)};
   auto events = side_.processTrade(trade);
   std::string expected_book =
     "A L2: 40@104.00\n"
@@ -375,13 +386,13 @@ TEST_F(BookSideTest, tradeSteamLeadTest4) {
     "A L2: 60@100.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 2);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::ADD, -1, true, 30, 99));
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::ADD, -1, true, 30, px(99)));
 
   // Will have pending liq add qty 30@99. It can be matched with 30@98
-  EXPECT_EQ(side_.matchPendingLiqAdd(10, 100), 0);
-  EXPECT_EQ(side_.matchPendingLiqAdd(10, 99), 10);
-  EXPECT_EQ(side_.matchPendingLiqAdd(10, 98), 10);
-  EXPECT_EQ(side_.matchPendingLiqAdd(10, 90), 10);
+  EXPECT_EQ(side_.matchPendingLiqAdd(10, px(100)), 0);
+  EXPECT_EQ(side_.matchPendingLiqAdd(10, px(99)), 10);
+  EXPECT_EQ(side_.matchPendingLiqAdd(10, px(98)), 10);
+  EXPECT_EQ(side_.matchPendingLiqAdd(10, px(90)), 10);
 }
 
 TEST_F(BookSideTest, l2SnapshotLeadReconcileOrderCancelTest) {
@@ -393,10 +404,10 @@ TEST_F(BookSideTest, l2SnapshotLeadReconcileOrderCancelTest) {
    * A L2: 60@100.00
    */
   L2SnapshotSide cur = {
-    {104, 40},
-    {103, 80},
-    {102, 60},
-    {101, 50},
+    {px(104), 40},
+    {px(103), 80},
+    {px(102), 60},
+    {px(101), 50},
   };
   side_.processL2Snapshot(cur);
   std::string expected_book =
@@ -407,7 +418,7 @@ TEST_F(BookSideTest, l2SnapshotLeadReconcileOrderCancelTest) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // The receive a trade or order cancel of 60@100. The book should not cahnge
-  side_.processOrderCancel(5, 60, 100);
+  side_.processOrderCancel(5, 60, px(100));
   EXPECT_EQ(getCurL2Book(), expected_book);
 }
 
@@ -420,10 +431,10 @@ TEST_F(BookSideTest, l2SnapshotLeadReconCileTradeTest) {
    * A L2: 60@100.00
    */
   L2SnapshotSide cur = {
-    {104, 40},
-    {103, 80},
-    {102, 60},
-    {101, 50},
+    {px(104), 40},
+    {px(103), 80},
+    {px(102), 60},
+    {px(101), 50},
   };
   side_.processL2Snapshot(cur);
   std::string expected_book =
@@ -434,17 +445,17 @@ TEST_F(BookSideTest, l2SnapshotLeadReconCileTradeTest) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // The receive a trade or order cancel of 60@100. The book should not cahnge
-  side_.processTrade({60, 100});
+  side_.processTrade({60, px(100)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 }
 
 TEST_F(BookSideTest, l2SnapshotLeadOddSnapTest) {
   // Test a strange l2 snapshot
   L2SnapshotSide cur = {
-    {130, 30},
-    {120, 20},
-    {95, 80},
-    {90, 40},
+    {px(130), 30},
+    {px(120), 20},
+    {px(95), 80},
+    {px(90), 40},
   };
   side_.processL2Snapshot(cur);
   std::string expected_book =
@@ -458,8 +469,8 @@ TEST_F(BookSideTest, l2SnapshotLeadOddSnapTest) {
 TEST_F(BookSideTest, l2SnapshotLeadMoreOddSnapTest) {
   // Test a strange l2 snapshot
   L2SnapshotSide cur = {
-    {105, 20},
-    {103, 10},
+    {px(105), 20},
+    {px(103), 10},
   };
   side_.processL2Snapshot(cur);
   std::string expected_book =
@@ -468,5 +479,172 @@ TEST_F(BookSideTest, l2SnapshotLeadMoreOddSnapTest) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 }
 
+TEST_F(BookSideTest, fingerprintTest) {
+  L2SnapshotSide cur = {
+    {px(104), 40},
+    {px(103), 80},
+    {px(102), 60},
+    {px(101), 50},
+    {px(100), 60},
+  };
+  EXPECT_EQ(side_.fingerprint(), l2Fingerprint(cur));
+  // The fingerprint follows fills, cancels and modifications
+  side_.processTrade({20, px(100)});
+  side_.processOrderCancel(2, 80, px(103));
+  side_.modifyOrder(1, 30, px(104));
+  cur = {
+    {px(104), 30},
+    {px(102), 60},
+    {px(101), 50},
+    {px(100), 40},
+  };
+  EXPECT_EQ(side_.fingerprint(), l2Fingerprint(cur));
+  // The empty levels are ignored
+  cur.emplace_back(px(99), 0);
+  EXPECT_EQ(side_.fingerprint(), l2Fingerprint(cur));
+}
+
+TEST_F(BookSideTest, l2SnapshotLagTest) {
+  // Sweep two levels, each fill saves the fingerprint of the side
+  Order aggressor(10, false, 80, px(101));
+  side_.processCrossedOrder(aggressor);
+  std::string expected_book =
+    "A L2: 40@104.00\n"
+    "A L2: 80@103.00\n"
+    "A L2: 60@102.00\n"
+    "A L2: 30@101.00\n";
+  EXPECT_EQ(getCurL2Book(), expected_book);
+
+  // The lagging snapshots match the saved states and won't change the book
+  L2SnapshotSide after_first_fill = {
+    {px(104), 40},
+    {px(103), 80},
+    {px(102), 60},
+    {px(101), 50},
+  };
+  EXPECT_TRUE(side_.processL2Snapshot(after_first_fill).empty());
+  L2SnapshotSide after_second_fill = {
+    {px(104), 40},
+    {px(103), 80},
+    {px(102), 60},
+    {px(101), 30},
+  };
+  EXPECT_TRUE(side_.processL2Snapshot(after_second_fill).empty());
+  EXPECT_EQ(getCurL2Book(), expected_book);
 }
 
+TEST_F(BookSideTest, l2SnapshotSkipForwardTest) {
+  Order aggressor(10, false, 80, px(101));
+  side_.processCrossedOrder(aggressor);
+  // The snapshot after the first fill is missed, the next one skips the stale expected snapshot
+  L2SnapshotSide after_second_fill = {
+    {px(104), 40},
+    {px(103), 80},
+    {px(102), 60},
+    {px(101), 30},
+  };
+  EXPECT_TRUE(side_.processL2Snapshot(after_second_fill).empty());
+  EXPECT_EQ(side_.droppedSnapshots(), 1);
+
+  // Nothing expected anymore, a new snapshot leads and is reconciled
+  L2SnapshotSide cur = {
+    {px(104), 40},
+    {px(103), 80},
+    {px(102), 60},
+  };
+  auto events = side_.processL2Snapshot(cur);
+  EXPECT_EQ(events.size(), 1);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 4, true, 30, px(101)));
+}
+
+TEST(BookSideDepthTest, l2SnapshotDepthTest) {
+  // The venue publishes the top 3 levels
+  BookSide<Ask> side(SnapshotMode::PER_FILL, 3);
+  side.addOrder(Order(1, true, 40, px(104)));
+  side.addOrder(Order(2, true, 80, px(103)));
+  side.addOrder(Order(3, true, 60, px(102)));
+  side.addOrder(Order(4, true, 50, px(101)));
+  side.addOrder(Order(5, true, 60, px(100)));
+
+  // The lagging snapshot only carries the top 3 levels
+  Order aggressor(10, false, 10, px(100));
+  side.processCrossedOrder(aggressor);
+  L2SnapshotSide lagging = {
+    {px(100), 50},
+    {px(101), 50},
+    {px(102), 60},
+  };
+  EXPECT_TRUE(side.processL2Snapshot(lagging).empty());
+  EXPECT_EQ(side.droppedSnapshots(), 0);
+
+  // The leading snapshot only reconciles the levels inside its window
+  L2SnapshotSide leading = {
+    {px(100), 50},
+    {px(101), 50},
+    {px(102), 30},
+  };
+  auto events = side.processL2Snapshot(leading);
+  EXPECT_EQ(events.size(), 1);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 3, true, 30, px(102)));
+  EXPECT_TRUE(side.existLevel(px(103)));
+  EXPECT_TRUE(side.existLevel(px(104)));
+  EXPECT_EQ(side.getL3Level(px(102)).quantity, 30);
+}
+
+TEST(BookSideCapacityTest, capacityTest) {
+  // A quiet instrument preallocates less than the defaults
+  BookCapacity capacity;
+  capacity.orders = 16;
+  capacity.price_levels = 8;
+  capacity.expected_snapshots = 4;
+  BookSide<Bid> side(SnapshotMode::PER_FILL, 0, nullptr, nullptr, capacity);
+  EXPECT_EQ(side.orderPool().capacity(), 16);
+  EXPECT_EQ(side.expectedSnapshotCapacity(), 4);
+  for (OrderId id = 0; id < 40; ++id) {
+    side.addOrder(Order(id, false, 10, px(100 - id)));
+  }
+  EXPECT_EQ(side.getL3Level(px(61)).quantity, 10);
+  EXPECT_EQ(side.orderPool().size(), 40);
+}
+
+TEST(BookSidePendingLiqTest, matchPendingLiqAddTest) {
+  // The trade on the empty side expects an aggressive order of 10 at 100 or better
+  BookSide<Ask> side;
+  auto events = side.processTrade(Trade(10, px(100)));
+  ASSERT_EQ(events.size(), 2);
+  // The better order matches the pending qty at 100, which is then used up
+  EXPECT_EQ(side.matchPendingLiqAdd(10, px(99)), 10);
+  // Nothing is left to match, the used up entry must not be matched again
+  EXPECT_EQ(side.matchPendingLiqAdd(5, px(99)), 0);
+  EXPECT_EQ(side.matchPendingLiqAdd(5, px(100)), 0);
+}
+
+TEST(BookSideSharedOrderMapTest, otherSideIdTest) {
+  // With a shared order map, an id of the other side doesn't touch either side
+  OrderMap orders;
+  BookSide<Bid> bids(SnapshotMode::PER_FILL, 0, &orders);
+  BookSide<Ask> asks(SnapshotMode::PER_FILL, 0, &orders);
+  bids.addOrder(Order(1, false, 10, px(99)));
+  asks.addOrder(Order(2, true, 20, px(101)));
+  auto bid_fingerprint = bids.fingerprint();
+  auto ask_fingerprint = asks.fingerprint();
+
+  bids.removeOrder(2);
+  bids.modifyOrder(2, 5, px(98));
+  asks.removeOrder(1);
+  asks.modifyOrder(1, 5, px(102));
+  EXPECT_EQ(bids.fingerprint(), bid_fingerprint);
+  EXPECT_EQ(asks.fingerprint(), ask_fingerprint);
+  EXPECT_FALSE(bids.existLevel(px(98)));
+  EXPECT_FALSE(asks.existLevel(px(102)));
+  EXPECT_EQ(asks.getL3Level(px(101)).quantity, 20);
+  EXPECT_EQ(bids.getL3Level(px(99)).quantity, 10);
+  EXPECT_EQ(orders.size(), 2);
+
+  bids.removeOrder(1);
+  EXPECT_FALSE(bids.existLevel(px(99)));
+  EXPECT_EQ(orders.size(), 1);
+  EXPECT_TRUE(asks.existOrder(2));
+}
+
+}
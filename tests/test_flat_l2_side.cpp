@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <vector>
+#include "flat_l2_side.h"
+
+namespace {
+using namespace OrderBook;
+
+using AskSide = FlatL2Side<AskComparator>;
+using BidSide = FlatL2Side<BidComparator>;
+
+template <typename Side>
+std::vector<Tick> getPrices(const Side& side) {
+  std::vector<Tick> prices;
+  for (const auto& level: side) {
+    prices.push_back(level.price);
+  }
+  return prices;
+}
+
+TEST(FlatL2SideTest, askOrderTest) {
+  AskSide side;
+  side[102].quantity = 20;
+  side[100].quantity = 60;
+  side[104].quantity = 40;
+  EXPECT_EQ(side.size(), 3);
+  EXPECT_TRUE(*side.begin() == L2PriceLevel(100, 60));
+  EXPECT_EQ(getPrices(side), (std::vector<Tick>{100, 102, 104}));
+  EXPECT_EQ(side.rbegin()->price, 104);
+}
+
+TEST(FlatL2SideTest, bidOrderTest) {
+  BidSide side;
+  side[95].quantity = 20;
+  side[92].quantity = 50;
+  side[94].quantity = 130;
+  EXPECT_EQ(side.begin()->price, 95);
+  EXPECT_EQ(getPrices(side), (std::vector<Tick>{95, 94, 92}));
+}
+
+TEST(FlatL2SideTest, findAndEraseTest) {
+  AskSide side;
+  for (Tick price = 100; price < 120; price += 2) {
+    side[price].quantity = static_cast<Quantity>(price);
+  }
+  EXPECT_EQ(side.find(101), side.end());
+  EXPECT_EQ(side.find(99), side.end());
+  EXPECT_EQ(side.find(130), side.end());
+  ASSERT_NE(side.find(110), side.end());
+  EXPECT_EQ(side.find(110)->quantity, 110);
+  EXPECT_EQ(side.erase(110), 1);
+  EXPECT_EQ(side.erase(110), 0);
+  EXPECT_EQ(side.count(110), 0);
+  EXPECT_EQ(side.count(112), 1);
+  EXPECT_EQ(getPrices(side), (std::vector<Tick>{100, 102, 104, 106, 108, 112, 114, 116, 118}));
+}
+
+TEST(FlatL2SideTest, randomOperationTest) {
+  // Same content as std::map after random inserts and erases, across the vectorized blocks and the tail
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<Tick> price_dist(-40, 40);
+  BidSide side;
+  std::map<Tick, Quantity, BidComparator> expected;
+  for (int i = 0; i < 2000; ++i) {
+    auto price = price_dist(gen);
+    if (gen() % 3 == 0) {
+      EXPECT_EQ(side.erase(price), expected.erase(price));
+    } else {
+      side[price].quantity = i;
+      expected[price] = i;
+    }
+    ASSERT_EQ(side.size(), expected.size());
+  }
+  auto iter = side.begin();
+  for (const auto& [price, quantity]: expected) {
+    EXPECT_TRUE(*iter == L2PriceLevel(price, quantity));
+    ++iter;
+  }
+}
+
+}
\ No newline at end of file
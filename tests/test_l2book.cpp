@@ -6,6 +6,9 @@
 namespace {
 using namespace OrderBook;
 
+// Convert the venue price to ticks as a decoder does
+Tick px(Price price) { return kDefaultTickSize.toTick(price); }
+
 class L2BookTest : public ::testing::Test {
 protected:
   void SetUp() override {
@@ -15,10 +18,10 @@ protected:
     //                      100,  30
     //   20        99
     //   50        98
-    book_.addLevel(true, 101, 40);
-    book_.addLevel(true, 100, 30);
-    book_.addLevel(false, 99, 20);
-    book_.addLevel(false, 98, 50);
+    book_.addLevel(true, px(101), 40);
+    book_.addLevel(true, px(100), 30);
+    book_.addLevel(false, px(99), 20);
+    book_.addLevel(false, px(98), 50);
   };
 
   std::string getCurL2Book() {
@@ -31,24 +34,24 @@ protected:
 };
 
 TEST_F(L2BookTest, existLevelTest) {
-  EXPECT_TRUE(book_.existLevel(true, 101));
-  EXPECT_TRUE(book_.existLevel(true, 100));
-  EXPECT_TRUE(book_.existLevel(false, 99));
-  EXPECT_TRUE(book_.existLevel(false, 98));
-  EXPECT_FALSE(book_.existLevel(true, 98));
-  EXPECT_FALSE(book_.existLevel(true, 95));
-  EXPECT_FALSE(book_.existLevel(true, 110));
+  EXPECT_TRUE(book_.existLevel(true, px(101)));
+  EXPECT_TRUE(book_.existLevel(true, px(100)));
+  EXPECT_TRUE(book_.existLevel(false, px(99)));
+  EXPECT_TRUE(book_.existLevel(false, px(98)));
+  EXPECT_FALSE(book_.existLevel(true, px(98)));
+  EXPECT_FALSE(book_.existLevel(true, px(95)));
+  EXPECT_FALSE(book_.existLevel(true, px(110)));
 }
 
 TEST_F(L2BookTest, getL2LevelTest) {
-  const auto& level = book_.getL2Level(true, 100);
-  EXPECT_EQ(level.price, 100);
+  const auto& level = book_.getL2Level(true, px(100));
+  EXPECT_EQ(level.price, px(100));
   EXPECT_EQ(level.quantity, 30);
 }
 
 TEST_F(L2BookTest, addLevelTest) {
   // Add a already existing level. Should not change the book
-  book_.addLevel(true, 100, 20);
+  book_.addLevel(true, px(100), 20);
   std::string cur_book = getCurL2Book();
   std::string expected_book =
     "A L2: 40@101.00\n"
@@ -59,8 +62,8 @@ TEST_F(L2BookTest, addLevelTest) {
 }
 
 TEST_F(L2BookTest, addLevelTest2) {
-  book_.addLevel(true, 102, 50);
-  book_.addLevel(false, 97.23, 60);
+  book_.addLevel(true, px(102), 50);
+  book_.addLevel(false, px(97.23), 60);
   std::string cur_book = getCurL2Book();
   std::string expected_book =
     "A L2: 50@102.00\n"
@@ -74,7 +77,7 @@ TEST_F(L2BookTest, addLevelTest2) {
 
 TEST_F(L2BookTest, updateLevelTest) {
   // Update a level that don't exists. The book should be unchanged
-  book_.updateLevel(true, 102, 50);
+  book_.updateLevel(true, px(102), 50);
   std::string cur_book = getCurL2Book();
   std::string expected_book =
     "A L2: 40@101.00\n"
@@ -83,7 +86,7 @@ TEST_F(L2BookTest, updateLevelTest) {
     "B L2: 50@98.00\n";
   EXPECT_EQ(cur_book, expected_book);
 
-  book_.updateLevel(true, 101, 80);
+  book_.updateLevel(true, px(101), 80);
   cur_book = getCurL2Book();
   expected_book =
     "A L2: 80@101.00\n"
@@ -95,7 +98,7 @@ TEST_F(L2BookTest, updateLevelTest) {
 
 TEST_F(L2BookTest, removeLevelTest) {
   // Remove a level that don't exist. The book should be unchanged
-  book_.removeLevel(true, 103);
+  book_.removeLevel(true, px(103));
   std::string cur_book = getCurL2Book();
   std::string expected_book =
     "A L2: 40@101.00\n"
@@ -105,7 +108,7 @@ TEST_F(L2BookTest, removeLevelTest) {
   EXPECT_EQ(cur_book, expected_book);
 
   // Remove A L2: 30@100
-  book_.removeLevel(true, 100);
+  book_.removeLevel(true, px(100));
   cur_book = getCurL2Book();
   expected_book =
     "A L2: 40@101.00\n"
@@ -113,7 +116,7 @@ TEST_F(L2BookTest, removeLevelTest) {
     "B L2: 50@98.00\n";
   EXPECT_EQ(cur_book, expected_book);
 
-  book_.removeLevel(false, 98);
+  book_.removeLevel(false, px(98));
   cur_book = getCurL2Book();
   expected_book =
     "A L2: 40@101.00\n"
@@ -122,14 +125,14 @@ TEST_F(L2BookTest, removeLevelTest) {
 }
 
 TEST_F(L2BookTest, addUpdateAndRemoveTest) {
-  book_.addLevel(false, 97, 40);
-  book_.addLevel(true, 102, 40);
-  book_.updateLevel(true, 101, 10);
-  book_.updateLevel(true, 100, 30);
-  book_.updateLevel(false, 99, 90);
-  book_.removeLevel(false, 98);
-  book_.removeLevel(true,100);
-  book_.removeLevel(true,102);
+  book_.addLevel(false, px(97), 40);
+  book_.addLevel(true, px(102), 40);
+  book_.updateLevel(true, px(101), 10);
+  book_.updateLevel(true, px(100), 30);
+  book_.updateLevel(false, px(99), 90);
+  book_.removeLevel(false, px(98));
+  book_.removeLevel(true, px(100));
+  book_.removeLevel(true, px(102));
   std::string cur_book = getCurL2Book();
   std::string expected_book =
     "A L2: 10@101.00\n"
@@ -137,4 +140,54 @@ TEST_F(L2BookTest, addUpdateAndRemoveTest) {
     "B L2: 40@97.00\n";
   EXPECT_EQ(cur_book, expected_book);
 }
-}
\ No newline at end of file
+
+TEST_F(L2BookTest, setLevelTest) {
+  auto version = book_.version();
+  book_.setLevel(true, px(102), 10);
+  book_.setLevel(true, px(101), 20);
+  book_.setLevel(false, px(98), 0);
+  EXPECT_EQ(book_.version(), version + 3);
+  std::string expected_book =
+    "A L2: 10@102.00\n"
+    "A L2: 20@101.00\n"
+    "A L2: 30@100.00\n"
+    "B L2: 20@99.00\n";
+  EXPECT_EQ(getCurL2Book(), expected_book);
+}
+
+TEST_F(L2BookTest, diffTest) {
+  L2Book target;
+  target.addLevel(true, px(102), 10);
+  target.addLevel(true, px(101), 40);
+  target.addLevel(false, px(99), 25);
+  target.addLevel(false, px(97), 50);
+  L2DeltaVec deltas;
+  book_.diff(target, deltas);
+  L2DeltaVec expected = {
+    {L2DeltaType::REMOVE, true, px(100), 0},
+    {L2DeltaType::ADD, true, px(102), 10},
+    {L2DeltaType::UPDATE, false, px(99), 25},
+    {L2DeltaType::REMOVE, false, px(98), 0},
+    {L2DeltaType::ADD, false, px(97), 50},
+  };
+  EXPECT_EQ(deltas, expected);
+
+  // Applying the deltas gives the target book
+  book_.apply(deltas);
+  std::ostringstream os;
+  os << target;
+  EXPECT_EQ(getCurL2Book(), os.str());
+  deltas.clear();
+  book_.diff(target, deltas);
+  EXPECT_TRUE(deltas.empty());
+
+  // From an empty book, every level is added
+  L2Book empty;
+  empty.diff(book_, deltas);
+  EXPECT_EQ(deltas.size(), 4);
+  empty.apply(deltas);
+  std::ostringstream empty_os;
+  empty_os << empty;
+  EXPECT_EQ(empty_os.str(), os.str());
+}
+}
@@ -1,21 +1,38 @@
 #include <gtest/gtest.h>
+#include <sstream>
+#include <vector>
 #include "level.h"
 
 namespace {
 using namespace OrderBook;
 
+// Convert the venue price to ticks as a decoder does
+Tick px(Price price) { return kDefaultTickSize.toTick(price); }
+
+TEST(TickSizeTest, conversionTest) {
+  TickSize tick_size(0.01);
+  EXPECT_EQ(tick_size.toTick(101.23), 10123);
+  // Float artifacts should not split one level into two
+  EXPECT_EQ(tick_size.toTick(0.1 + 0.2), tick_size.toTick(0.3));
+  EXPECT_DOUBLE_EQ(tick_size.toPrice(10123), 101.23);
+
+  TickSize coarse_tick_size(0.5);
+  EXPECT_EQ(coarse_tick_size.toTick(101.5), 203);
+  EXPECT_DOUBLE_EQ(coarse_tick_size.toPrice(203), 101.5);
+}
+
 TEST(L2levelTest, initializationTest) {
-  L2PriceLevel l{2.3, 100};
-  EXPECT_EQ(l.price, 2.3);
+  L2PriceLevel l{px(2.3), 100};
+  EXPECT_EQ(l.price, px(2.3));
   EXPECT_EQ(l.quantity, 100);
 }
 
 TEST(L2levelTest, updateTest) {
-  L2PriceLevel l{2.3, 100};
-  EXPECT_EQ(l.price, 2.3);
+  L2PriceLevel l{px(2.3), 100};
+  EXPECT_EQ(l.price, px(2.3));
   EXPECT_EQ(l.quantity, 100);
   l.quantity = 50;
-  EXPECT_EQ(l.price, 2.3);
+  EXPECT_EQ(l.price, px(2.3));
   EXPECT_EQ(l.quantity, 50);
 }
 
@@ -29,71 +46,90 @@ TEST(L3levelTest, initializationTest) {
 
 TEST(L3levelTest, addOrderTest) {
   L3PriceLevel l3;
-  auto order = std::make_shared<Order>(1, true, 100, 101);
-  auto iter = l3.addOrder(order);
+  Order order(1, true, 100, px(101));
+  l3.addOrder(&order);
   EXPECT_EQ(l3.num_orders, 1);
   EXPECT_EQ(l3.quantity, 100);
-  auto cur_order = *iter;
-  EXPECT_EQ(cur_order->is_sell, true);
-  EXPECT_EQ(cur_order->quantity, 100);
-  EXPECT_EQ(cur_order->price, 101);
+  auto& cur_order = l3.orders.back();
+  EXPECT_EQ(cur_order.is_sell, true);
+  EXPECT_EQ(cur_order.quantity, 100);
+  EXPECT_EQ(cur_order.price, px(101));
 }
 
 TEST(L3levelTest, removeOrderTest) {
   L3PriceLevel l3;
   // Add the first order
-  auto order = std::make_shared<Order>(1, true, 100, 101);
-  auto iter = l3.addOrder(order);
+  Order order(1, true, 100, px(101));
+  l3.addOrder(&order);
   EXPECT_EQ(l3.num_orders, 1);
   EXPECT_EQ(l3.quantity, 100);
-  auto cur_order = *iter;
+  auto* cur_order = &l3.orders.back();
   EXPECT_EQ(cur_order->is_sell, true);
   EXPECT_EQ(cur_order->quantity, 100);
-  EXPECT_EQ(cur_order->price, 101);
+  EXPECT_EQ(cur_order->price, px(101));
 
   // Add the second order
-  auto another_order = std::make_shared<Order>(2, true, 300, 101);
-  auto another_iter = l3.addOrder(another_order);
+  Order another_order(2, true, 300, px(101));
+  l3.addOrder(&another_order);
   EXPECT_EQ(l3.num_orders, 2);
   EXPECT_EQ(l3.quantity, 400);
-  cur_order = *another_iter;
+  cur_order = &l3.orders.back();
   EXPECT_EQ(cur_order->is_sell, true);
   EXPECT_EQ(cur_order->quantity, 300);
-  EXPECT_EQ(cur_order->price, 101);
+  EXPECT_EQ(cur_order->price, px(101));
 
   // Remove the first order
-  OrderHandler handler = {order, iter};
-  l3.removeOrder(handler);
+  l3.removeOrder(&order);
   EXPECT_EQ(l3.num_orders, 1);
   EXPECT_EQ(l3.quantity, 300);
-  cur_order = *l3.orders.begin();
+  cur_order = &*l3.orders.begin();
   EXPECT_EQ(cur_order->is_sell, true);
   EXPECT_EQ(cur_order->quantity, 300);
-  EXPECT_EQ(cur_order->price, 101);
+  EXPECT_EQ(cur_order->price, px(101));
 
   // Remove the second order
-  handler = {another_order, another_iter};
-  l3.removeOrder(handler);
+  l3.removeOrder(&another_order);
   EXPECT_EQ(l3.num_orders, 0);
   EXPECT_EQ(l3.quantity, 0);
   EXPECT_TRUE(l3.orders.empty());
 }
 
+TEST(L3levelTest, orderQueueTest) {
+  // The orders keep their time priority when removing from the middle of the queue
+  L3PriceLevel l3;
+  Order first(1, true, 10, px(101));
+  Order second(2, true, 20, px(101));
+  Order third(3, true, 30, px(101));
+  l3.addOrder(&first);
+  l3.addOrder(&second);
+  l3.addOrder(&third);
+  l3.removeOrder(&second);
+  std::vector<OrderId> ids;
+  for (const auto& order: l3.orders) {
+    ids.push_back(order.odid);
+  }
+  EXPECT_EQ(ids, (std::vector<OrderId>{1, 3}));
+  EXPECT_EQ(first.next, &third);
+  EXPECT_EQ(third.prev, &first);
+  EXPECT_EQ(second.prev, nullptr);
+  EXPECT_EQ(second.next, nullptr);
+}
+
 TEST(L3levelTest, modifyOrderTest) {
   L3PriceLevel l3;
-  auto order = std::make_shared<Order>(1, true, 100, 101);
-  auto iter = l3.addOrder(order);
+  Order order(1, true, 100, px(101));
+  l3.addOrder(&order);
   EXPECT_EQ(l3.num_orders, 1);
   EXPECT_EQ(l3.quantity, 100);
-  l3.modifyOrder(order, 50, 101);
+  l3.modifyOrder(order, 50, px(101));
   EXPECT_EQ(l3.num_orders, 1);
   EXPECT_EQ(l3.quantity, 50);
 }
 
 TEST(L3levelTest, fillOrderTest) {
   L3PriceLevel l3;
-  auto order = std::make_shared<Order>(1, true, 100, 101);
-  auto iter = l3.addOrder(order);
+  Order order(1, true, 100, px(101));
+  l3.addOrder(&order);
   EXPECT_EQ(l3.num_orders, 1);
   EXPECT_EQ(l3.quantity, 100);
   l3.fillOrder(order, 20);
@@ -101,4 +137,15 @@ TEST(L3levelTest, fillOrderTest) {
   EXPECT_EQ(l3.quantity, 80);
 }
 
+TEST(L3levelTest, printTest) {
+  // The level and its orders are printed with the tick size of the instrument
+  TickSize tick_size(0.5);
+  L3PriceLevel l3;
+  Order order(1, true, 100, 203);
+  l3.addOrder(&order);
+  std::ostringstream os;
+  l3.print(os, tick_size);
+  EXPECT_EQ(os.str(), "L3: 100@101.50\nOrders:([1, 100@101.50])\n");
+}
+
 }
\ No newline at end of file
@@ -1,10 +1,14 @@
 #include <gtest/gtest.h>
+#include <array>
 #include <sstream>
 #include "order_book.h"
 
 namespace {
 using namespace OrderBook;
 
+// Convert the venue price to ticks as a decoder does
+Tick px(Price price) { return kDefaultTickSize.toTick(price); }
+
 class SmartOrderBookTest : public ::testing::Test {
 protected:
   void SetUp() override {
@@ -33,7 +37,7 @@ protected:
 
   void addOrders(int nums, bool is_sell, Price price) {
     for (int i = 0; i < nums; ++i) {
-      book_.processOrderAddMessage({MessageType::ADD, id++, is_sell, 10, price});
+      book_.processOrderAddMessage({MessageType::ADD, id++, is_sell, 10, px(price)});
     }
   }
 
@@ -62,7 +66,7 @@ TEST_F(SmartOrderBookTest, initializationTest) {
 
 TEST_F(SmartOrderBookTest, orderAddTest) {
   // Add an order 10@105, won't cross orderbook
-  auto events = book_.processOrderAddMessage({MessageType::ADD, 100, true, 10, 105});
+  auto events = book_.processOrderAddMessage({MessageType::ADD, 100, true, 10, px(105)});
   std::string expected_book =
     "A L2: 10@105.00\n"
     "A L2: 60@104.00\n"
@@ -75,12 +79,12 @@ TEST_F(SmartOrderBookTest, orderAddTest) {
     "B L2: 50@92.00\n";
   EXPECT_EQ(getCurL2Book(), expected_book);
   EXPECT_EQ(events.size(), 1);
-  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::ADD, 100, true, 10, 105));
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::ADD, 100, true, 10, px(105)));
 }
 
 TEST_F(SmartOrderBookTest, orderSteamLeadTest) {
   // Add an aggressive bid order 90@102
-  auto events = book_.processOrderAddMessage({MessageType::ADD, 100, false, 90, 102});
+  auto events = book_.processOrderAddMessage({MessageType::ADD, 100, false, 90, px(102)});
   std::string expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -93,18 +97,18 @@ TEST_F(SmartOrderBookTest, orderSteamLeadTest) {
   EXPECT_EQ(events.size(), 9);
   // Receive the expected trades. Won't change order book
   for (int i = 0; i < 3; ++i) {
-    book_.processTradeMessage({10, 101});
+    book_.processTradeMessage({10, px(101)});
   }
   EXPECT_EQ(getCurL2Book(), expected_book);
   for (int i = 0; i < 6; ++i) {
-    book_.processTradeMessage({10, 102});
+    book_.processTradeMessage({10, px(102)});
   }
   EXPECT_EQ(getCurL2Book(), expected_book);
 }
 
 TEST_F(SmartOrderBookTest, orderSteamLeadTest2) {
   // Add an aggressive bid order 50@101
-  auto events = book_.processOrderAddMessage({MessageType::ADD, 100, false, 50, 101});
+  auto events = book_.processOrderAddMessage({MessageType::ADD, 100, false, 50, px(101)});
   std::string expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -118,12 +122,12 @@ TEST_F(SmartOrderBookTest, orderSteamLeadTest2) {
   EXPECT_EQ(events.size(), 4);
   // Receive the expected trades. Won't change order book
   for (int i = 0; i < 3; ++i) {
-    book_.processTradeMessage({10, 101});
+    book_.processTradeMessage({10, px(101)});
   }
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive an unexpected tarde. Will change the order book
-  book_.processTradeMessage({10, 101});
+  book_.processTradeMessage({10, px(101)});
   expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -139,7 +143,7 @@ TEST_F(SmartOrderBookTest, orderSteamLeadTest2) {
 
 TEST_F(SmartOrderBookTest, orderSteamLeadTest3) {
   // Add an aggressive ask order 50@101
-  auto events = book_.processOrderAddMessage({MessageType::ADD, 100, true, 40, 95});
+  auto events = book_.processOrderAddMessage({MessageType::ADD, 100, true, 40, px(95)});
   std::string expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -154,19 +158,19 @@ TEST_F(SmartOrderBookTest, orderSteamLeadTest3) {
 
   // Receive the expected trades. Won't change order book
   for (int i = 0; i < 2; ++i) {
-    book_.processTradeMessage({10, 95});
+    book_.processTradeMessage({10, px(95)});
   }
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive an unexpected trade. Will change the order book
-  book_.processTradeMessage({10, 95});
+  book_.processTradeMessage({10, px(95)});
   EXPECT_TRUE(getCurL2Book() != expected_book);
 }
 
 TEST_F(SmartOrderBookTest, tradeSteamLeadTest1) {
   // Receive two trade 10@101, 10@95 first
-  auto events = book_.processTradeMessage({10, 101});
-  auto events2 = book_.processTradeMessage({10, 95});
+  auto events = book_.processTradeMessage({10, px(101)});
+  auto events2 = book_.processTradeMessage({10, px(95)});
   std::string expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -179,13 +183,13 @@ TEST_F(SmartOrderBookTest, tradeSteamLeadTest1) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Received the expect orders. although the orders are aggressive but they won't change the order book
-  book_.processOrderAddMessage({MessageType::ADD, 100, false, 10, 101});
+  book_.processOrderAddMessage({MessageType::ADD, 100, false, 10, px(101)});
   EXPECT_EQ(getCurL2Book(), expected_book);
-  book_.processOrderAddMessage({MessageType::ADD, 101,true, 10, 95});
+  book_.processOrderAddMessage({MessageType::ADD, 101,true, 10, px(95)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive another new order. Will change order book
-  book_.processOrderAddMessage({MessageType::ADD, 102, false, 10, 100});
+  book_.processOrderAddMessage({MessageType::ADD, 102, false, 10, px(100)});
   expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -211,7 +215,7 @@ TEST_F(SmartOrderBookTest, tradeSteamLeadTest2) {
   *     50@92              (5 x 10@92)
   */
   // Receive a trade 10@102 first
-  book_.processTradeMessage({10, 102});
+  book_.processTradeMessage({10, px(102)});
   std::string expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -223,19 +227,19 @@ TEST_F(SmartOrderBookTest, tradeSteamLeadTest2) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive the order cancellation later
-  book_.processOrderCancelMessage({MessageType::CANCEL, 25, true, 10, 101});
+  book_.processOrderCancelMessage({MessageType::CANCEL, 25, true, 10, px(101)});
   EXPECT_EQ(getCurL2Book(), expected_book);
-  book_.processOrderCancelMessage({MessageType::CANCEL, 26, true, 10, 101});
+  book_.processOrderCancelMessage({MessageType::CANCEL, 26, true, 10, px(101)});
   EXPECT_EQ(getCurL2Book(), expected_book);
-  book_.processOrderCancelMessage({MessageType::CANCEL, 27, true, 10, 101});
+  book_.processOrderCancelMessage({MessageType::CANCEL, 27, true, 10, px(101)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive the liquidity taking order on bid side 10@102, although it's aggressive order, but won't change the order book
-  book_.processOrderAddMessage({MessageType::ADD, 100, false, 10, 102});
+  book_.processOrderAddMessage({MessageType::ADD, 100, false, 10, px(102)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive the same order, but this time the order book will change
-  book_.processOrderAddMessage({MessageType::ADD, 101, false, 10, 102});
+  book_.processOrderAddMessage({MessageType::ADD, 101, false, 10, px(102)});
   EXPECT_TRUE(getCurL2Book() != expected_book);
 }
 
@@ -251,7 +255,7 @@ TEST_F(SmartOrderBookTest, tradeSteamLeadTest3) {
   *     50@92              (5 x 10@92)
   */
   // Receive a trade 10@102 first
-  book_.processTradeMessage({10, 94});
+  book_.processTradeMessage({10, px(94)});
   std::string expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -263,17 +267,17 @@ TEST_F(SmartOrderBookTest, tradeSteamLeadTest3) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive the order cancellation later
-  book_.processOrderCancelMessage({MessageType::CANCEL, 28, false, 10, 95});
+  book_.processOrderCancelMessage({MessageType::CANCEL, 28, false, 10, px(95)});
   EXPECT_EQ(getCurL2Book(), expected_book);
-  book_.processOrderCancelMessage({MessageType::CANCEL, 29, false, 10, 95});
+  book_.processOrderCancelMessage({MessageType::CANCEL, 29, false, 10, px(95)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive the liquidity taking order on ask side 10@94, although it's aggressive order, but won't change the order book
-  book_.processOrderAddMessage({MessageType::ADD, 100, true, 10, 94});
+  book_.processOrderAddMessage({MessageType::ADD, 100, true, 10, px(94)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive the same order, but this time the order book will change
-  book_.processOrderAddMessage({MessageType::ADD, 101, true, 10, 94});
+  book_.processOrderAddMessage({MessageType::ADD, 101, true, 10, px(94)});
   EXPECT_TRUE(getCurL2Book() != expected_book);
 }
 
@@ -290,7 +294,7 @@ TEST_F(SmartOrderBookTest, tradeSteamLeadTest4) {
   *     50@92              (5 x 10@92)
   */
   // Receive a trade 10@99, the order book keeps unchanged
-  book_.processTradeMessage({10, 99});
+  book_.processTradeMessage({10, px(99)});
   std::string expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -303,15 +307,15 @@ TEST_F(SmartOrderBookTest, tradeSteamLeadTest4) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive two expected orders Ask 10@99 and Bid 10@99, book keeps unchanged
-  book_.processOrderAddMessage({MessageType::ADD, 100, false, 10, 99});
+  book_.processOrderAddMessage({MessageType::ADD, 100, false, 10, px(99)});
   EXPECT_EQ(getCurL2Book(), expected_book);
-  book_.processOrderAddMessage({MessageType::ADD, 101, true, 10, 99});
+  book_.processOrderAddMessage({MessageType::ADD, 101, true, 10, px(99)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // From now on, the incoming new orders will change the order book
   // Two same orders Ask 10@99 and Bid 10@99 received. The order book will change
-  book_.processOrderAddMessage({MessageType::ADD, 102, false, 10, 98});
-  book_.processOrderAddMessage({MessageType::ADD, 103, true, 10, 99});
+  book_.processOrderAddMessage({MessageType::ADD, 102, false, 10, px(98)});
+  book_.processOrderAddMessage({MessageType::ADD, 103, true, 10, px(99)});
   expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -338,7 +342,7 @@ TEST_F(SmartOrderBookTest, testNormalOrderModif) {
   *     50@92              (5 x 10@92)
   */
   // Modif the order from Ask 10@104 to Ask 20@104
-  book_.processOrderModifyMessage({MessageType::MODIFY, 1, true, 20, 104});
+  book_.processOrderModifyMessage({MessageType::MODIFY, 1, true, 20, px(104)});
   std::string expected_book =
     "A L2: 70@104.00\n"  // ==> changed from 60 to 70 here
     "A L2: 70@103.00\n"
@@ -363,7 +367,7 @@ TEST_F(SmartOrderBookTest, testOrderModifAndOrderLeadTrade) {
   *     50@92              (5 x 10@92)
   */
   // Modify the order from Ask 10@104 to Ask 10@94, will trigger a trade 10@95
-  book_.processOrderModifyMessage({MessageType::MODIFY, 1, true, 10, 95});
+  book_.processOrderModifyMessage({MessageType::MODIFY, 1, true, 10, px(95)});
   std::string expected_book =
     "A L2: 50@104.00\n"  // ==> change from 60 to 50 here
     "A L2: 70@103.00\n"
@@ -376,7 +380,7 @@ TEST_F(SmartOrderBookTest, testOrderModifAndOrderLeadTrade) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive the trade, the book should keep unchanged
-  book_.processTradeMessage({10, 95});
+  book_.processTradeMessage({10, px(95)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 }
 
@@ -393,7 +397,7 @@ TEST_F(SmartOrderBookTest, testOrderModifAndTradeLeadOrder) {
   *     50@92              (5 x 10@92)
   */
   // Receive a trade 10@99
-  book_.processTradeMessage({10, 99});
+  book_.processTradeMessage({10, px(99)});
   std::string expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -406,7 +410,7 @@ TEST_F(SmartOrderBookTest, testOrderModifAndTradeLeadOrder) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive a order modif from 10@95 => 10@99,
-  book_.processOrderModifyMessage({MessageType::MODIFY, 28, false, 10, 99});
+  book_.processOrderModifyMessage({MessageType::MODIFY, 28, false, 10, px(99)});
   expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -419,7 +423,7 @@ TEST_F(SmartOrderBookTest, testOrderModifAndTradeLeadOrder) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive a order modif from 10@101 => 10@99,
-  book_.processOrderModifyMessage({MessageType::MODIFY, 27, true, 10, 99});
+  book_.processOrderModifyMessage({MessageType::MODIFY, 27, true, 10, px(99)});
   expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -432,7 +436,7 @@ TEST_F(SmartOrderBookTest, testOrderModifAndTradeLeadOrder) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive a order B 10@99, this order will show in order book
-  book_.processOrderAddMessage({MessageType::ADD, 100, false, 10, 99});
+  book_.processOrderAddMessage({MessageType::ADD, 100, false, 10, px(99)});
   expected_book =
     "A L2: 60@104.00\n"
     "A L2: 70@103.00\n"
@@ -461,16 +465,16 @@ TEST_F(SmartOrderBookTest, testL2SnapLeadLiqRemove) {
    *     50@92              (5 x 10@92)
    */
   L2SnapshotSide ask = {
-    {104, 60},
-    {103, 70},
-    {102, 110},
-    {101, 20},
+    {px(104), 60},
+    {px(103), 70},
+    {px(102), 110},
+    {px(101), 20},
   };
   L2SnapshotSide bid = {
-    {95, 10},
-    {94, 130},
-    {93, 70},
-    {92, 50},
+    {px(95), 10},
+    {px(94), 130},
+    {px(93), 70},
+    {px(92), 50},
   };
   auto events = book_.processSnapshotMessage({bid, ask});
   std::string expected_book =
@@ -485,9 +489,9 @@ TEST_F(SmartOrderBookTest, testL2SnapLeadLiqRemove) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive two cancel. But it should not udpate the orderbook
-  book_.processOrderCancelMessage({MessageType::CANCEL, 25, true, 10, 101});
+  book_.processOrderCancelMessage({MessageType::CANCEL, 25, true, 10, px(101)});
   EXPECT_EQ(getCurL2Book(), expected_book);
-  book_.processOrderCancelMessage({MessageType::CANCEL, 28, false, 10, 95});
+  book_.processOrderCancelMessage({MessageType::CANCEL, 28, false, 10, px(95)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 }
 
@@ -506,16 +510,16 @@ TEST_F(SmartOrderBookTest, testL2SnapLeadLiqAdd) {
    *     50@92              (5 x 10@92)
    */
   L2SnapshotSide ask = {
-    {104, 60},
-    {103, 70},
-    {102, 110},
-    {101, 40},  // ==> from 30 to 40
+    {px(104), 60},
+    {px(103), 70},
+    {px(102), 110},
+    {px(101), 40},  // ==> from 30 to 40
   };
   L2SnapshotSide bid = {
-    {95, 30}, // ==> from 20 to 30
-    {94, 130},
-    {93, 70},
-    {92, 50},
+    {px(95), 30}, // ==> from 20 to 30
+    {px(94), 130},
+    {px(93), 70},
+    {px(92), 50},
   };
   auto events = book_.processSnapshotMessage({bid, ask});
   std::string expected_book =
@@ -530,10 +534,320 @@ TEST_F(SmartOrderBookTest, testL2SnapLeadLiqAdd) {
   EXPECT_EQ(getCurL2Book(), expected_book);
 
   // Receive two cancel. But it should not udpate the orderbook
-  book_.processOrderAddMessage({MessageType::ADD, 100, true, 10, 101});
+  book_.processOrderAddMessage({MessageType::ADD, 100, true, 10, px(101)});
   EXPECT_EQ(getCurL2Book(), expected_book);
-  book_.processOrderAddMessage({MessageType::ADD, 101, false, 10, 95});
+  book_.processOrderAddMessage({MessageType::ADD, 101, false, 10, px(95)});
   EXPECT_EQ(getCurL2Book(), expected_book);
 }
 
+TEST_F(SmartOrderBookTest, eventSinkTest) {
+  // The events of several messages are appended to the same buffer
+  OrderInfoVec events;
+  events.reserve(16);
+  auto* data = events.data();
+  book_.processOrderAddMessage({MessageType::ADD, 100, true, 10, px(105)}, events);
+  book_.processOrderModifyMessage({MessageType::MODIFY, 100, true, 20, px(105)}, events);
+  book_.processOrderAddMessage({MessageType::ADD, 101, false, 15, px(101)}, events);
+  ASSERT_EQ(events.size(), 4);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::ADD, 100, true, 10, px(105)));
+  EXPECT_TRUE(events[1] == OrderInfo(OrderEvent::MODIF, 100, true, 20, px(105)));
+  EXPECT_TRUE(events[2] == OrderInfo(OrderEvent::EXEC, 25, true, 10, px(101)));
+  EXPECT_TRUE(events[3] == OrderInfo(OrderEvent::EXEC, 26, true, 5, px(101)));
+  // No reallocation of the reused buffer
+  EXPECT_EQ(events.data(), data);
+}
+
+TEST_F(SmartOrderBookTest, inlineSinkTest) {
+  // Any sink other than a buffer is called as each event is emitted, with the book already updated for it
+  struct InlineSink {
+    void onEvent(const OrderInfo& info) {
+      events.push_back(info);
+      in_book.push_back(book.existOrder(info.odid));
+    }
+
+    SmartOrderBook& book;
+    OrderInfoVec events;
+    std::vector<bool> in_book;
+  };
+  InlineSink sink{book_, {}, {}};
+  book_.processOrderAddMessage({MessageType::ADD, 100, false, 15, px(101)}, sink);
+  ASSERT_EQ(sink.events.size(), 2);
+  EXPECT_TRUE(sink.events[0] == OrderInfo(OrderEvent::EXEC, 25, true, 10, px(101)));
+  EXPECT_TRUE(sink.events[1] == OrderInfo(OrderEvent::EXEC, 26, true, 5, px(101)));
+  EXPECT_FALSE(sink.in_book[0]);
+  EXPECT_TRUE(sink.in_book[1]);
+
+  book_.processOrderCancelMessage({MessageType::CANCEL, 24, true, 10, px(102)}, sink);
+  ASSERT_EQ(sink.events.size(), 3);
+  EXPECT_TRUE(sink.events[2] == OrderInfo(OrderEvent::CANCEL, 24, true, 10, px(102)));
+  EXPECT_FALSE(sink.in_book[2]);
+}
+
+TEST(SmartOrderBookSnapshotModeTest, perMessageTest) {
+  // One expected snapshot per message, the sweep of three resting orders records only one
+  SmartOrderBook book(TickSize(), SnapshotMode::PER_MESSAGE);
+  book.processOrderAddMessage({MessageType::ADD, 1, true, 10, px(101)});
+  book.processOrderAddMessage({MessageType::ADD, 2, true, 10, px(101)});
+  book.processOrderAddMessage({MessageType::ADD, 3, true, 20, px(102)});
+  auto events = book.processOrderAddMessage({MessageType::ADD, 4, false, 30, px(102)});
+  EXPECT_EQ(events.size(), 3);
+
+  // The lagging snapshots published after each message match the recorded ones
+  L2SnapshotSide bid;
+  std::vector<L2SnapshotSide> asks = {
+    {{px(101), 10}},
+    {{px(101), 20}},
+    {{px(102), 20}, {px(101), 20}},
+    {{px(102), 10}},
+  };
+  for (const auto& ask: asks) {
+    EXPECT_TRUE(book.processSnapshotMessage({bid, ask}).empty());
+  }
+
+  // All the expected snapshots are consumed, so the next one leads and is reconciled
+  events = book.processSnapshotMessage({bid, {}});
+  EXPECT_EQ(events.size(), 1);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 3, true, 10, px(102)));
+  std::ostringstream os;
+  os << book.getL2Book();
+  EXPECT_EQ(os.str(), "");
+}
+
+TEST(SmartOrderBookSnapshotModeTest, perMessageCancelTest) {
+  // A cancel records its expected snapshot like the other messages
+  SmartOrderBook book(TickSize(), SnapshotMode::PER_MESSAGE);
+  book.processOrderAddMessage({MessageType::ADD, 1, true, 10, px(101)});
+  book.processOrderAddMessage({MessageType::ADD, 2, true, 5, px(101)});
+  book.processOrderCancelMessage({MessageType::CANCEL, 1, true, 10, px(101)});
+
+  // The snapshot published after the cancel matches, the ones of the adds before it are stale
+  L2SnapshotSide bid;
+  EXPECT_TRUE(book.processSnapshotMessage({bid, {{px(101), 5}}}).empty());
+
+  // All the expected snapshots are consumed, so the next one leads and is reconciled
+  auto events = book.processSnapshotMessage({bid, {}});
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 2, true, 5, px(101)));
+}
+
+TEST(SmartOrderBookBatchTest, batchTest) {
+  std::vector<BookMessage> msgs = {
+    OrderMessage{MessageType::ADD, 1, true, 10, px(101)},
+    OrderMessage{MessageType::ADD, 2, true, 10, px(101)},
+    OrderMessage{MessageType::ADD, 3, true, 20, px(102)},
+    OrderMessage{MessageType::ADD, 4, false, 30, px(102)},
+    TradeMessage(20, px(101)),
+    TradeMessage(10, px(102)),
+  };
+  // Same events as processing the messages one by one
+  SmartOrderBook batch_book;
+  SmartOrderBook book;
+  auto events = batch_book.processBatch(msgs);
+  OrderInfoVec expected;
+  book.processOrderAddMessage(std::get<OrderMessage>(msgs[0]), expected);
+  book.processOrderAddMessage(std::get<OrderMessage>(msgs[1]), expected);
+  book.processOrderAddMessage(std::get<OrderMessage>(msgs[2]), expected);
+  book.processOrderAddMessage(std::get<OrderMessage>(msgs[3]), expected);
+  book.processTradeMessage(std::get<TradeMessage>(msgs[4]), expected);
+  book.processTradeMessage(std::get<TradeMessage>(msgs[5]), expected);
+  EXPECT_EQ(events, expected);
+
+  // Only the state at the end of the batch is expected, the snapshot of an intermediate state is ignored
+  L2SnapshotSide bid;
+  EXPECT_TRUE(batch_book.processSnapshotMessage({bid, {{px(101), 20}}}).empty());
+  EXPECT_TRUE(batch_book.processSnapshotMessage({bid, {{px(102), 10}}}).empty());
+  // The expected snapshot is consumed, so the next one leads and is reconciled
+  events = batch_book.processSnapshotMessage({bid, {}});
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, 3, true, 10, px(102)));
+}
+
+TEST(SmartOrderBookBatchTest, snapshotInBatchTest) {
+  // A snapshot in the batch is matched with the state reached before it
+  SmartOrderBook book(TickSize(), SnapshotMode::PER_MESSAGE);
+  L2SnapshotSide bid;
+  std::vector<BookMessage> msgs = {
+    OrderMessage{MessageType::ADD, 1, true, 10, px(101)},
+    OrderMessage{MessageType::ADD, 2, true, 10, px(102)},
+    SnapshotMessage{bid, {{px(101), 10}, {px(102), 10}}},
+    OrderMessage{MessageType::CANCEL, 2, true, 10, px(102)},
+  };
+  auto events = book.processBatch(msgs);
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_TRUE(events[2] == OrderInfo(OrderEvent::CANCEL, 2, true, 10, px(102)));
+  EXPECT_TRUE(book.processSnapshotMessage({bid, {{px(101), 10}}}).empty());
+}
+
+TEST(SmartOrderBookModifyTest, queuePositionTest) {
+  SmartOrderBook book;
+  book.processOrderAddMessage({MessageType::ADD, 1, true, 10, px(101)});
+  book.processOrderAddMessage({MessageType::ADD, 2, true, 10, px(101)});
+  // A quantity down keeps the place in the queue
+  auto events = book.processOrderModifyMessage({MessageType::MODIFY, 1, true, 5, px(101)});
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::MODIF, 1, true, 5, px(101)));
+  // The bid side guesses the aggressor first, the fill of the ask side comes last
+  events = book.processTradeMessage({5, px(101)});
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_TRUE(events.back() == OrderInfo(OrderEvent::EXEC, 1, true, 5, px(101)));
+
+  // A quantity up loses the place in the queue
+  book.processOrderAddMessage({MessageType::ADD, 3, true, 10, px(101)});
+  book.processOrderModifyMessage({MessageType::MODIFY, 2, true, 20, px(101)});
+  events = book.processTradeMessage({10, px(101)});
+  ASSERT_EQ(events.size(), 3);
+  EXPECT_TRUE(events.back() == OrderInfo(OrderEvent::EXEC, 3, true, 10, px(101)));
+
+  // A price change crossing the book is uncrossed, only the modification is reported
+  book.processOrderAddMessage({MessageType::ADD, 4, false, 5, px(99)});
+  events = book.processOrderModifyMessage({MessageType::MODIFY, 2, true, 20, px(99)});
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_FALSE(book.existOrder(4));
+  EXPECT_EQ(book.getOrderHandler(2).order->getRemainingQuantity(), 15);
+  std::ostringstream os;
+  os << book.getL2Book();
+  EXPECT_EQ(os.str(), "A L2: 15@99.00\n");
+}
+
+TEST(SmartOrderBookOrderMapTest, sharedOrderMapTest) {
+  // Both sides share one order map, an order is only found on its own side
+  SmartOrderBook book;
+  book.processOrderAddMessage({MessageType::ADD, 1, true, 10, px(101)});
+  EXPECT_TRUE(book.existOrder(1));
+  EXPECT_TRUE(book.getOrderHandler(1).order->is_sell);
+  EXPECT_TRUE(book.processOrderCancelMessage({MessageType::CANCEL, 1, false, 10, px(101)}).size() == 0);
+  EXPECT_TRUE(book.existOrder(1));
+  auto events = book.processOrderCancelMessage({MessageType::CANCEL, 1, true, 10, px(101)});
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::CANCEL, 1, true, 10, px(101)));
+  EXPECT_FALSE(book.existOrder(1));
+
+  // The fake orders of the snapshot reconciliation get distinct ids across the sides
+  book.processSnapshotMessage({{{px(99), 10}}, {{px(101), 10}}});
+  events = book.processSnapshotMessage({{}, {}});
+  ASSERT_EQ(events.size(), 2);
+  EXPECT_TRUE(events[0] == OrderInfo(OrderEvent::EXEC, kFirstFakeOrderId, false, 10, px(99)));
+  EXPECT_TRUE(events[1] == OrderInfo(OrderEvent::EXEC, kFirstFakeOrderId - 1, true, 10, px(101)));
+  EXPECT_FALSE(book.existOrder(kFirstFakeOrderId));
+  EXPECT_FALSE(book.existOrder(kFirstFakeOrderId - 1));
+}
+
+TEST(SmartOrderBookOrderMapTest, fakeOrderIdTest) {
+  // The fake order of a leading snapshot doesn't take the id of a venue order
+  SmartOrderBook book;
+  book.processSnapshotMessage({{{px(99), 10}}, {}});
+  EXPECT_TRUE(book.existOrder(kFirstFakeOrderId));
+  auto events = book.processOrderAddMessage({MessageType::ADD, 100, true, 10, px(101)});
+  ASSERT_EQ(events.size(), 1);
+  EXPECT_TRUE(book.bbo().ask == L2PriceLevel(px(101), 10));
+  EXPECT_TRUE(book.bbo().bid == L2PriceLevel(px(99), 10));
+
+  // A duplicated id is detected and dropped on either side, the order in the book is kept
+  EXPECT_TRUE(book.processOrderAddMessage({MessageType::ADD, 100, false, 20, px(98)}).empty());
+  EXPECT_TRUE(book.processOrderAddMessage({MessageType::ADD, 100, true, 20, px(102)}).empty());
+  // Nor does it uncross the book
+  EXPECT_TRUE(book.processOrderAddMessage({MessageType::ADD, 100, false, 20, px(101)}).empty());
+  EXPECT_EQ(book.duplicateOrderCount(), 3);
+  EXPECT_TRUE(book.bbo().ask == L2PriceLevel(px(101), 10));
+  EXPECT_TRUE(book.getOrderHandler(100).order->is_sell);
+  EXPECT_EQ(book.getOrderHandler(100).order->price, px(101));
+  std::array<L2PriceLevel, 2> levels;
+  EXPECT_EQ(book.topLevels(true, 2, levels), 1);
+  EXPECT_EQ(book.topLevels(false, 2, levels), 1);
+}
+
+TEST(SmartOrderBookL2Test, maintainedL2BookTest) {
+  SmartOrderBook book;
+  const auto& l2_book = book.getL2Book();
+  auto version = l2_book.version();
+  book.processOrderAddMessage({MessageType::ADD, 1, true, 10, px(101)});
+  book.processOrderAddMessage({MessageType::ADD, 2, false, 10, px(99)});
+  EXPECT_GT(l2_book.version(), version);
+  // Same view, updated in place
+  EXPECT_EQ(&book.getL2Book(), &l2_book);
+  EXPECT_TRUE(l2_book.existLevel(true, px(101)));
+
+  // Nothing changed, the version is the same
+  version = l2_book.version();
+  book.processOrderCancelMessage({MessageType::CANCEL, 3, true, 10, px(101)});
+  EXPECT_EQ(l2_book.version(), version);
+
+  book.processOrderAddMessage({MessageType::ADD, 3, true, 5, px(99)});
+  EXPECT_FALSE(l2_book.existLevel(true, px(99)));
+  std::ostringstream os;
+  os << l2_book;
+  EXPECT_EQ(os.str(), "A L2: 10@101.00\nB L2: 5@99.00\n");
+}
+
+TEST(SmartOrderBookL2Test, printL3Test) {
+  // The L3 levels are printed with the tick size of the book
+  SmartOrderBook book(TickSize(0.5));
+  book.processOrderAddMessage({MessageType::ADD, 1, true, 10, 203});
+  book.processOrderAddMessage({MessageType::ADD, 2, false, 5, 200});
+  std::ostringstream os;
+  book.printL3(os);
+  EXPECT_EQ(os.str(), "A L3: 10@101.50\nOrders:([1, 10@101.50])\nB L3: 5@100.00\nOrders:([2, 5@100.00])\n");
+}
+
+TEST(SmartOrderBookL2Test, topLevelsTest) {
+  SmartOrderBook book;
+  auto bbo = book.bbo();
+  EXPECT_EQ(bbo.bid.quantity, 0);
+  EXPECT_EQ(bbo.ask.quantity, 0);
+  book.processOrderAddMessage({MessageType::ADD, 1, true, 10, px(102)});
+  book.processOrderAddMessage({MessageType::ADD, 2, true, 20, px(101)});
+  book.processOrderAddMessage({MessageType::ADD, 3, true, 30, px(103)});
+  book.processOrderAddMessage({MessageType::ADD, 4, false, 40, px(99)});
+  bbo = book.bbo();
+  EXPECT_TRUE(bbo.bid == L2PriceLevel(px(99), 40));
+  EXPECT_TRUE(bbo.ask == L2PriceLevel(px(101), 20));
+
+  std::array<L2PriceLevel, 2> levels;
+  ASSERT_EQ(book.topLevels(true, 5, levels), 2);
+  EXPECT_TRUE(levels[0] == L2PriceLevel(px(101), 20));
+  EXPECT_TRUE(levels[1] == L2PriceLevel(px(102), 10));
+  ASSERT_EQ(book.topLevels(false, 5, levels), 1);
+  EXPECT_TRUE(levels[0] == L2PriceLevel(px(99), 40));
+
+  // The touch moves to the next level when the best one is removed
+  book.processOrderCancelMessage({MessageType::CANCEL, 2, true, 20, px(101)});
+  EXPECT_TRUE(book.bbo().ask == L2PriceLevel(px(102), 10));
+  // A change behind the touch leaves it unchanged
+  book.processOrderModifyMessage({MessageType::MODIFY, 3, true, 5, px(103)});
+  EXPECT_TRUE(book.bbo().ask == L2PriceLevel(px(102), 10));
+  book.processOrderAddMessage({MessageType::ADD, 5, false, 40, px(102)});
+  EXPECT_TRUE(book.bbo().ask == L2PriceLevel(px(103), 5));
+  EXPECT_TRUE(book.bbo().bid == L2PriceLevel(px(102), 30));
+}
+
+TEST(SmartOrderBookSnapshotViewTest, sameEventsTest) {
+  // The view of the encoded snapshot gives the same events and book as the snapshot message
+  SmartOrderBook message_book;
+  SmartOrderBook view_book;
+  for (auto book: {&message_book, &view_book}) {
+    book->processOrderAddMessage({MessageType::ADD, 1, true, 10, px(101)});
+    book->processOrderAddMessage({MessageType::ADD, 2, true, 20, px(102)});
+    book->processOrderAddMessage({MessageType::ADD, 3, false, 30, px(99)});
+    book->processOrderAddMessage({MessageType::ADD, 4, false, 10, px(98)});
+  }
+  // The snapshot of the current state is expected and confirmed without events
+  SnapshotMessage expected{{{px(99), 30}, {px(98), 10}}, {{px(101), 10}, {px(102), 20}}};
+  std::vector<std::byte> buffer;
+  encodeSnapshot(expected, buffer);
+  EXPECT_TRUE(message_book.processSnapshotMessage(expected).empty());
+  EXPECT_TRUE(view_book.processSnapshotMessage(SnapshotView(buffer)).empty());
+
+  // A leading snapshot guesses the same events
+  SnapshotMessage leading{{{px(99), 20}, {px(97), 5}}, {{px(101), 10}, {px(102), 25}, {px(103), 5}}};
+  buffer.clear();
+  encodeSnapshot(leading, buffer);
+  auto events = message_book.processSnapshotMessage(leading);
+  EXPECT_FALSE(events.empty());
+  EXPECT_EQ(view_book.processSnapshotMessage(SnapshotView(buffer)), events);
+  std::ostringstream message_os;
+  std::ostringstream view_os;
+  message_os << message_book.getL2Book();
+  view_os << view_book.getL2Book();
+  EXPECT_EQ(view_os.str(), message_os.str());
+}
 }
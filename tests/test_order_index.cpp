@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+#include "order_index.h"
+
+namespace {
+using namespace OrderBook;
+
+TEST(OrderIndexTest, findOrInsertTest) {
+  OrderIndex<int> index;
+  auto [value, inserted] = index.findOrInsert(1);
+  EXPECT_TRUE(inserted);
+  *value = 100;
+  auto [same_value, inserted_again] = index.findOrInsert(1);
+  EXPECT_FALSE(inserted_again);
+  EXPECT_EQ(*same_value, 100);
+  EXPECT_EQ(index.size(), 1);
+  EXPECT_TRUE(index.contains(1));
+  EXPECT_FALSE(index.contains(2));
+  EXPECT_EQ(index.find(2), nullptr);
+}
+
+TEST(OrderIndexTest, findAndEraseTest) {
+  OrderIndex<int> index;
+  for (int id = 0; id < 10; ++id) {
+    *index.findOrInsert(id).first = id * 10;
+  }
+  int value = 0;
+  EXPECT_TRUE(index.findAndErase(3, value));
+  EXPECT_EQ(value, 30);
+  EXPECT_FALSE(index.findAndErase(3, value));
+  EXPECT_FALSE(index.erase(100));
+  EXPECT_EQ(index.size(), 9);
+  // The remaining entries are still reachable after the backward shift
+  for (int id = 0; id < 10; ++id) {
+    if (id == 3) continue;
+    ASSERT_NE(index.find(id), nullptr);
+    EXPECT_EQ(*index.find(id), id * 10);
+  }
+}
+
+TEST(OrderIndexTest, eraseFoundValueTest) {
+  OrderIndex<int> index;
+  for (int id = 0; id < 100; ++id) {
+    *index.findOrInsert(id).first = id * 10;
+  }
+  for (int id = 0; id < 100; id += 2) {
+    index.erase(index.find(id));
+  }
+  EXPECT_EQ(index.size(), 50);
+  for (int id = 0; id < 100; ++id) {
+    if (id % 2 == 0) {
+      EXPECT_EQ(index.find(id), nullptr);
+    } else {
+      ASSERT_NE(index.find(id), nullptr);
+      EXPECT_EQ(*index.find(id), id * 10);
+    }
+  }
+}
+
+TEST(OrderIndexTest, growTest) {
+  OrderIndex<int> index(16);
+  for (int id = 1; id <= 1000; ++id) {
+    *index.findOrInsert(id).first = -id;
+  }
+  EXPECT_EQ(index.size(), 1000);
+  EXPECT_GE(index.capacity(), 1024);
+  for (int id = 1; id <= 1000; ++id) {
+    EXPECT_EQ(*index.find(id), -id);
+  }
+}
+
+TEST(OrderIndexTest, randomOperationTest) {
+  // Compare with std::unordered_map under a random mix of add and cancel
+  OrderIndex<int> index;
+  std::unordered_map<int, int> expected;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> id_dist(0, 2000);
+  for (int i = 0; i < 50000; ++i) {
+    int id = id_dist(rng);
+    if (rng() % 2 == 0) {
+      auto [value, inserted] = index.findOrInsert(id);
+      EXPECT_EQ(inserted, expected.find(id) == expected.end());
+      *value = i;
+      expected[id] = i;
+    } else {
+      int value = 0;
+      bool erased = index.findAndErase(id, value);
+      EXPECT_EQ(erased, expected.find(id) != expected.end());
+      if (erased) {
+        EXPECT_EQ(value, expected[id]);
+        expected.erase(id);
+      }
+    }
+  }
+  EXPECT_EQ(index.size(), expected.size());
+  for (const auto& [id, value]: expected) {
+    ASSERT_NE(index.find(id), nullptr);
+    EXPECT_EQ(*index.find(id), value);
+  }
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "order_pool.h"
+
+namespace {
+using namespace OrderBook;
+
+TEST(OrderPoolTest, createAndDestroyTest) {
+  OrderPool pool(4);
+  auto order = pool.create(Order(1, true, 100, 10100));
+  EXPECT_EQ(order->odid, 1);
+  EXPECT_EQ(order->quantity, 100);
+  EXPECT_EQ(order->price, 10100);
+  EXPECT_EQ(pool.size(), 1);
+  EXPECT_EQ(pool.capacity(), 4);
+
+  // The slot is recycled for the next order
+  pool.destroy(order);
+  EXPECT_EQ(pool.size(), 0);
+  auto another_order = pool.create(Order(2, false, 50, 9900));
+  EXPECT_EQ(another_order, order);
+  EXPECT_EQ(another_order->odid, 2);
+  EXPECT_EQ(pool.highWaterMark(), 1);
+}
+
+TEST(OrderPoolTest, growTest) {
+  OrderPool pool(4);
+  std::vector<Order*> orders;
+  for (int i = 0; i < 4; ++i) {
+    orders.push_back(pool.create(Order(i, true, 10, 10100)));
+  }
+  EXPECT_EQ(pool.numSlabs(), 1);
+
+  // Grow geometrically without moving the live orders
+  orders.push_back(pool.create(Order(4, true, 10, 10100)));
+  EXPECT_EQ(pool.numSlabs(), 2);
+  EXPECT_EQ(pool.capacity(), 8);
+  for (int i = 5; i < 9; ++i) {
+    orders.push_back(pool.create(Order(i, true, 10, 10100)));
+  }
+  EXPECT_EQ(pool.numSlabs(), 3);
+  EXPECT_EQ(pool.capacity(), 16);
+  for (int i = 0; i < 9; ++i) {
+    EXPECT_EQ(orders[i]->odid, i);
+  }
+
+  for (auto order: orders) {
+    pool.destroy(order);
+  }
+  EXPECT_EQ(pool.size(), 0);
+  EXPECT_EQ(pool.highWaterMark(), 9);
+  EXPECT_EQ(pool.capacity(), 16);
+}
+
+}
\ No newline at end of file
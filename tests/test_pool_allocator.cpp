@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "pool_allocator.h"
+
+namespace {
+using namespace OrderBook;
+
+TEST(PoolAllocatorTest, reuseNodeTest) {
+  PoolAllocator<std::pair<const long, int>> allocator;
+  auto* first = allocator.allocate(1);
+  allocator.deallocate(first, 1);
+  // The freed node is handed out again
+  auto* second = allocator.allocate(1);
+  EXPECT_EQ(first, second);
+  allocator.deallocate(second, 1);
+
+  // Array allocations don't come from the pool
+  auto* array = allocator.allocate(16);
+  EXPECT_NE(array, nullptr);
+  allocator.deallocate(array, 16);
+}
+
+TEST(PoolAllocatorTest, mapTest) {
+  std::map<long, int, std::less<long>, PoolAllocator<std::pair<const long, int>>> levels;
+  for (long price = 100; price < 1100; ++price) {
+    levels[price] = static_cast<int>(price);
+  }
+  EXPECT_EQ(levels.size(), 1000);
+  // Flickering level at the touch reuses the same node
+  levels.erase(100);
+  auto* node = &*levels.emplace(99, 1).first;
+  levels.erase(99);
+  EXPECT_EQ(node, &*levels.emplace(100, 2).first);
+  EXPECT_EQ(levels.begin()->second, 2);
+  EXPECT_EQ(levels.rbegin()->first, 1099);
+}
+
+TEST(PoolAllocatorTest, listAndUnorderedMapTest) {
+  std::list<int, PoolAllocator<int>> orders;
+  for (int i = 0; i < 100; ++i) orders.push_back(i);
+  orders.remove_if([](int i) { return i % 2 == 0; });
+  EXPECT_EQ(orders.size(), 50);
+  EXPECT_EQ(orders.front(), 1);
+
+  std::unordered_map<long, int, std::hash<long>, std::equal_to<long>, PoolAllocator<std::pair<const long, int>>> qty;
+  for (long price = 0; price < 500; ++price) qty[price] = 1;
+  qty.erase(10);
+  EXPECT_EQ(qty.size(), 499);
+  EXPECT_EQ(qty.count(10), 0);
+  EXPECT_EQ(qty[20], 1);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <vector>
+#include "price_ladder.h"
+
+namespace {
+using namespace OrderBook;
+
+using AskLadder = PriceLadder<int, AskComparator>;
+using BidLadder = PriceLadder<int, BidComparator>;
+
+template <typename Ladder>
+std::vector<Tick> getPrices(const Ladder& ladder) {
+  std::vector<Tick> prices;
+  for (const auto& [price, level]: ladder) {
+    prices.push_back(price);
+  }
+  return prices;
+}
+
+TEST(PriceLadderTest, askOrderTest) {
+  AskLadder ladder{AskComparator()};
+  ladder[102] = 20;
+  ladder[100] = 60;
+  ladder[104] = 40;
+  EXPECT_EQ(ladder.size(), 3);
+  EXPECT_EQ(ladder.begin()->first, 100);
+  EXPECT_EQ(ladder.begin()->second, 60);
+  EXPECT_EQ(getPrices(ladder), (std::vector<Tick>{100, 102, 104}));
+
+  std::vector<Tick> reversed;
+  for (auto iter = ladder.rbegin(); iter != ladder.rend(); ++iter) {
+    reversed.push_back(iter->first);
+  }
+  EXPECT_EQ(reversed, (std::vector<Tick>{104, 102, 100}));
+}
+
+TEST(PriceLadderTest, bidOrderTest) {
+  BidLadder ladder{BidComparator()};
+  ladder[95] = 20;
+  ladder[92] = 50;
+  ladder[94] = 130;
+  EXPECT_EQ(ladder.begin()->first, 95);
+  EXPECT_EQ(getPrices(ladder), (std::vector<Tick>{95, 94, 92}));
+}
+
+TEST(PriceLadderTest, findAndEraseTest) {
+  AskLadder ladder{AskComparator()};
+  ladder[100] = 60;
+  ladder[101] = 50;
+  ladder[105] = 10;
+  EXPECT_TRUE(ladder.find(101) != ladder.end());
+  EXPECT_TRUE(ladder.find(103) == ladder.end());
+  EXPECT_EQ(ladder.count(105), 1);
+
+  // Erase the best level, the next level becomes the best
+  EXPECT_EQ(ladder.erase(100), 1);
+  EXPECT_EQ(ladder.begin()->first, 101);
+  // Erase the worst level
+  EXPECT_EQ(ladder.erase(105), 1);
+  EXPECT_EQ(getPrices(ladder), (std::vector<Tick>{101}));
+  // Erase a level that doesn't exist
+  EXPECT_EQ(ladder.erase(110), 0);
+  EXPECT_EQ(ladder.erase(101), 1);
+  EXPECT_TRUE(ladder.empty());
+  EXPECT_TRUE(ladder.begin() == ladder.end());
+}
+
+TEST(PriceLadderTest, recenterTest) {
+  AskLadder ladder{AskComparator(), 16};
+  ladder[1000] = 1;
+  auto* level = &ladder[1000];
+  // Market drifts away from the initial anchor, the ladder recenters and grows
+  for (Tick price = 1001; price < 1100; ++price) {
+    ladder[price] = static_cast<int>(price - 1000);
+  }
+  ladder[900] = 7;
+  EXPECT_GE(ladder.capacity(), 200);
+  EXPECT_EQ(ladder.size(), 101);
+  EXPECT_EQ(ladder.begin()->first, 900);
+  // The level address is stable across recentering
+  EXPECT_EQ(level, &ladder[1000]);
+  EXPECT_EQ(ladder[1050], 50);
+
+  ladder.erase(900);
+  EXPECT_EQ(ladder.begin()->first, 1000);
+  EXPECT_EQ(getPrices(ladder).size(), 100);
+}
+
+TEST(PriceLadderTest, farPriceTest) {
+  // A stub quote far from the touch goes to the overflow instead of growing the window to reach it
+  AskLadder ladder{AskComparator()};
+  ladder[10000] = 1;
+  ladder[10000 + (1 << 27)] = 2;
+  EXPECT_LE(ladder.capacity(), ladder.maxCapacity());
+  EXPECT_EQ(ladder.overflowSize(), 1);
+  EXPECT_EQ(ladder.size(), 2);
+  EXPECT_EQ(getPrices(ladder), (std::vector<Tick>{10000, 10000 + (1 << 27)}));
+  EXPECT_EQ(ladder.find(10000 + (1 << 27))->second, 2);
+  EXPECT_EQ(ladder.count(10000 + (1 << 27)), 1);
+
+  // The window moves to the overflow level once it's the best level
+  auto* far_level = &ladder[10000 + (1 << 27)];
+  ladder.erase(10000);
+  EXPECT_EQ(ladder.overflowSize(), 0);
+  EXPECT_EQ(ladder.begin()->first, 10000 + (1 << 27));
+  EXPECT_EQ(far_level, &ladder[10000 + (1 << 27)]);
+  ladder.erase(10000 + (1 << 27));
+  EXPECT_TRUE(ladder.empty());
+}
+
+TEST(PriceLadderTest, farBetterPriceTest) {
+  // A far better price moves the window to the new touch, the old levels go to the overflow
+  BidLadder ladder{BidComparator(), 16, 64};
+  for (Tick price = 100; price < 110; ++price) {
+    ladder[price] = static_cast<int>(price);
+  }
+  auto* level = &ladder[105];
+  ladder[1000] = 1000;
+  EXPECT_EQ(ladder.capacity(), 64);
+  EXPECT_EQ(ladder.overflowSize(), 10);
+  EXPECT_EQ(ladder.begin()->first, 1000);
+  EXPECT_EQ(level, &ladder[105]);
+  std::vector<Tick> reversed;
+  for (auto iter = ladder.rbegin(); iter != ladder.rend(); ++iter) {
+    reversed.push_back(iter->first);
+  }
+  EXPECT_EQ(reversed, (std::vector<Tick>{100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 1000}));
+
+  ladder.erase(1000);
+  EXPECT_EQ(ladder.overflowSize(), 0);
+  EXPECT_EQ(ladder.begin()->first, 109);
+  EXPECT_EQ(ladder.size(), 10);
+}
+
+TEST(PriceLadderTest, randomOperationTest) {
+  // Compare with std::map under a random mix of near and far prices with a small window
+  AskLadder ladder{AskComparator(), 16, 64};
+  std::map<Tick, int> expected;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<Tick> near_dist(900, 1100);
+  std::uniform_int_distribution<Tick> far_dist(-100000, 100000);
+  for (int i = 0; i < 20000; ++i) {
+    auto price = rng() % 8 == 0 ? far_dist(rng) : near_dist(rng);
+    if (rng() % 2 == 0) {
+      ladder[price] = i;
+      expected[price] = i;
+    } else {
+      EXPECT_EQ(ladder.erase(price), expected.erase(price));
+    }
+    ASSERT_EQ(ladder.size(), expected.size());
+    if (!expected.empty()) ASSERT_EQ(ladder.begin()->first, expected.begin()->first);
+  }
+  std::vector<std::pair<Tick, int>> levels;
+  for (const auto& [price, level]: ladder) {
+    levels.emplace_back(price, level);
+  }
+  EXPECT_EQ(levels, (std::vector<std::pair<Tick, int>>(expected.begin(), expected.end())));
+  std::vector<Tick> reversed;
+  for (auto iter = ladder.rbegin(); iter != ladder.rend(); ++iter) {
+    reversed.push_back(iter->first);
+  }
+  std::vector<Tick> expected_reversed;
+  for (auto iter = expected.rbegin(); iter != expected.rend(); ++iter) {
+    expected_reversed.push_back(iter->first);
+  }
+  EXPECT_EQ(reversed, expected_reversed);
+  EXPECT_LE(ladder.capacity(), 64);
+}
+
+}
\ No newline at end of file
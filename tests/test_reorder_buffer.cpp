@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "reorder_buffer.h"
+
+namespace {
+using namespace OrderBook;
+
+OrderMessage addMessage(OrderId id, Timestamp timestamp) {
+  return {MessageType::ADD, id, true, 10, 100, 0, timestamp};
+}
+
+TEST(ReorderBufferTest, windowTest) {
+  ReorderBuffer buffer(100);
+  std::vector<Timestamp> released;
+  auto release = [&released](const BookMessage& msg) { released.push_back(timestampOf(msg)); };
+  buffer.push(addMessage(1, 1000), release);
+  buffer.push(TradeMessage(10, 100, 0, 1050), release);
+  // The lagging message is put back in order
+  buffer.push(addMessage(2, 1020), release);
+  EXPECT_TRUE(released.empty());
+  EXPECT_EQ(buffer.size(), 3);
+
+  // The messages older than 1130 - 100 are out of the window
+  buffer.push(addMessage(3, 1130), release);
+  EXPECT_EQ(released, (std::vector<Timestamp>{1000, 1020}));
+  buffer.flush(release);
+  EXPECT_EQ(released, (std::vector<Timestamp>{1000, 1020, 1050, 1130}));
+  EXPECT_TRUE(buffer.empty());
+}
+
+TEST(ReorderBufferTest, sameTimestampTest) {
+  // At the same timestamp, orders come before trades and trades before snapshots
+  ReorderBuffer buffer(10);
+  std::vector<std::size_t> streams;
+  auto release = [&streams](const BookMessage& msg) { streams.push_back(msg.index()); };
+  buffer.push(SnapshotMessage{{}, {}, 0, 500}, release);
+  buffer.push(TradeMessage(10, 100, 0, 500), release);
+  buffer.push(addMessage(1, 500), release);
+  buffer.flush(release);
+  EXPECT_EQ(streams, (std::vector<std::size_t>{0, 1, 2}));
+}
+
+TEST(ReorderBufferTest, lateMessageTest) {
+  ReorderBuffer buffer(10);
+  std::vector<Timestamp> released;
+  auto release = [&released](const BookMessage& msg) { released.push_back(timestampOf(msg)); };
+  buffer.push(addMessage(1, 100), release);
+  buffer.push(addMessage(2, 200), release);
+  EXPECT_EQ(released, (std::vector<Timestamp>{100}));
+  // Too late to be reordered
+  buffer.push(addMessage(3, 50), release);
+  EXPECT_EQ(released, (std::vector<Timestamp>{100, 50}));
+  EXPECT_EQ(buffer.lateCount(), 1);
+}
+
+}
\ No newline at end of file
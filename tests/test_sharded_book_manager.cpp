@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "sharded_book_manager.h"
+
+namespace {
+using namespace OrderBook;
+
+// Convert the venue price to ticks as a decoder does
+Tick px(Price price) { return kDefaultTickSize.toTick(price); }
+
+struct CountingListener {
+  void onOrderAdd(SmartOrderBook&, const OrderInfo&) { ++adds; }
+  void onOrderCancel(SmartOrderBook&, const OrderInfo&) { ++cancels; }
+  void onOrderModify(SmartOrderBook&, const OrderInfo&) {}
+  void onOrderExecution(SmartOrderBook&, const OrderInfo&) { ++executions; }
+
+  int adds{0};
+  int cancels{0};
+  int executions{0};
+};
+
+TEST(ShardedBookManagerTest, routeTest) {
+  std::vector<CountingListener> listeners(2);
+  ShardConfig config;
+  // Instrument 0 and 1 on shard 1, instrument 2 on shard 0
+  config.instrument_shards = {1, 1, 0};
+  config.ring_capacity = 16;
+  ShardedBookManager<CountingListener> manager({&listeners[0], &listeners[1]}, 3, config);
+  EXPECT_EQ(manager.numShards(), 2);
+  EXPECT_EQ(manager.shardOf(1), 1);
+  EXPECT_EQ(manager.localInstrument(1), 1);
+  EXPECT_EQ(manager.localInstrument(2), 0);
+
+  // More messages than the ring capacity
+  for (OrderId id = 0; id < 100; ++id) {
+    auto instrument = static_cast<InstrumentId>(id % 3);
+    manager.dispatch(OrderMessage{MessageType::ADD, id, true, 10, px(101), instrument});
+  }
+  manager.dispatch(TradeMessage(10, px(101), 2));
+  manager.waitIdle();
+  EXPECT_EQ(listeners[1].adds, 67);
+  // The trade also guesses an aggressive order on the empty bid side
+  EXPECT_EQ(listeners[0].adds, 34);
+  EXPECT_EQ(listeners[0].executions, 2);
+  EXPECT_TRUE(manager.book(0).existOrder(0));
+  EXPECT_TRUE(manager.book(1).existOrder(1));
+  // The order 2 is filled by the trade
+  EXPECT_FALSE(manager.book(2).existOrder(2));
+  EXPECT_TRUE(manager.book(2).existOrder(5));
+  EXPECT_FALSE(manager.book(0).existOrder(1));
+}
+
+TEST(ShardedBookManagerTest, bookConfigTest) {
+  // The book of each instrument is built with its config on its shard
+  std::vector<CountingListener> listeners(2);
+  ShardConfig config;
+  config.book_configs.resize(3);
+  config.book_configs[1].tick_size = TickSize(0.5);
+  config.book_configs[2].snapshot_depth = 10;
+  ShardedBookManager<CountingListener> manager({&listeners[0], &listeners[1]}, 3, config);
+  EXPECT_EQ(manager.book(0).tickSize().size, 0.01);
+  EXPECT_EQ(manager.book(1).tickSize().size, 0.5);
+  EXPECT_EQ(manager.book(2).snapshotDepth(), 10);
+  EXPECT_EQ(manager.book(1).snapshotDepth(), 0);
+}
+
+TEST(ShardedBookManagerTest, stopTest) {
+  // The messages dispatched before stop are processed
+  std::vector<CountingListener> listeners(3);
+  ShardedBookManager<CountingListener> manager({&listeners[0], &listeners[1], &listeners[2]}, 3);
+  for (OrderId id = 0; id < 30; ++id) {
+    manager.dispatch(OrderMessage{MessageType::ADD, id, false, 10, px(99), static_cast<InstrumentId>(id % 3)});
+  }
+  manager.stop();
+  for (const auto& listener: listeners) {
+    EXPECT_EQ(listener.adds, 10);
+  }
+}
+
+TEST(ShardedBookManagerTest, dropTest) {
+  // The messages of an unknown instrument and the messages dispatched after stop are dropped
+  std::vector<CountingListener> listeners(2);
+  ShardConfig config;
+  config.ring_capacity = 4;
+  ShardedBookManager<CountingListener> manager({&listeners[0], &listeners[1]}, 2, config);
+  EXPECT_FALSE(manager.dispatch(OrderMessage{MessageType::ADD, 1, true, 10, px(101), 2}));
+  EXPECT_FALSE(manager.dispatch(OrderMessage{MessageType::ADD, 1, true, 10, px(101), kUnknownInstrument}));
+  EXPECT_TRUE(manager.dispatch(OrderMessage{MessageType::ADD, 1, true, 10, px(101), 0}));
+  manager.stop();
+  // More messages than the ring capacity, dispatch returns instead of spinning on the full ring
+  for (OrderId id = 2; id < 10; ++id) {
+    EXPECT_FALSE(manager.dispatch(OrderMessage{MessageType::ADD, id, true, 10, px(101), 1}));
+  }
+  EXPECT_EQ(manager.droppedMessageCount(), 10);
+  EXPECT_EQ(listeners[0].adds, 1);
+  EXPECT_EQ(listeners[1].adds, 0);
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+#include "snapshot_ring.h"
+
+namespace {
+using namespace OrderBook;
+
+TEST(SnapshotRingTest, pushPopTest) {
+  SnapshotRing ring(4);
+  EXPECT_TRUE(ring.empty());
+  EXPECT_EQ(ring.capacity(), 4);
+  ring.push_back(1);
+  ring.push_back(2);
+  EXPECT_EQ(ring.size(), 2);
+  EXPECT_EQ(ring.front(), 1);
+  ring.pop_front();
+  EXPECT_EQ(ring.front(), 2);
+  EXPECT_EQ(ring.dropped(), 0);
+}
+
+TEST(SnapshotRingTest, overwriteTest) {
+  // The oldest entries are overwritten when the ring is full
+  SnapshotRing ring(4);
+  for (L2Fingerprint fingerprint = 1; fingerprint <= 6; ++fingerprint) {
+    ring.push_back(fingerprint);
+  }
+  EXPECT_EQ(ring.size(), 4);
+  EXPECT_EQ(ring.front(), 3);
+  EXPECT_EQ(ring.dropped(), 2);
+}
+
+TEST(SnapshotRingTest, skipForwardTest) {
+  SnapshotRing ring(8);
+  for (L2Fingerprint fingerprint = 10; fingerprint < 15; ++fingerprint) {
+    ring.push_back(fingerprint);
+  }
+  EXPECT_EQ(ring.find(13), 3);
+  EXPECT_EQ(ring.find(20), ring.size());
+  ring.skip(ring.find(13));
+  EXPECT_EQ(ring.front(), 13);
+  EXPECT_EQ(ring.size(), 2);
+  EXPECT_EQ(ring.dropped(), 3);
+}
+
+}
\ No newline at end of file
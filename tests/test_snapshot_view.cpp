@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include "snapshot_view.h"
+
+namespace {
+using namespace OrderBook;
+
+TEST(SnapshotViewTest, decodeTest) {
+  SnapshotMessage msg{{{99, 30}, {98, 10}}, {{101, 10}, {102, 20}, {103, 5}}, 7, 123456789};
+  std::vector<std::byte> buffer;
+  encodeSnapshot(msg, buffer);
+  SnapshotView view(buffer);
+  ASSERT_TRUE(view.valid());
+  EXPECT_EQ(view.bytes(), buffer.size());
+  EXPECT_EQ(view.instrument(), 7);
+  EXPECT_EQ(view.timestamp(), 123456789);
+  ASSERT_EQ(view.bidLevels().size(), 2);
+  ASSERT_EQ(view.askLevels().size(), 3);
+  EXPECT_TRUE(view.askLevels()[2] == L2PriceLevel(103, 5));
+  L2SnapshotSide bid_levels(view.bidLevels().begin(), view.bidLevels().end());
+  EXPECT_EQ(bid_levels, msg.bid_levels);
+  L2SnapshotSide ask_levels(view.askLevels().begin(), view.askLevels().end());
+  EXPECT_EQ(ask_levels, msg.ask_levels);
+  EXPECT_EQ(l2Fingerprint(view.askLevels()), l2Fingerprint(msg.ask_levels));
+}
+
+TEST(SnapshotViewTest, packetTest) {
+  // Two snapshots back to back in one packet, the second one starts where the first one ends
+  std::vector<std::byte> buffer;
+  encodeSnapshot({{{99, 30}}, {}, 1, 10}, buffer);
+  encodeSnapshot({{}, {{101, 10}}, 2, 20}, buffer);
+  Span<const std::byte> packet(buffer);
+  SnapshotView first(packet);
+  ASSERT_TRUE(first.valid());
+  EXPECT_EQ(first.instrument(), 1);
+  EXPECT_TRUE(first.askLevels().empty());
+  SnapshotView second(packet.subspan(first.bytes(), packet.size() - first.bytes()));
+  ASSERT_TRUE(second.valid());
+  EXPECT_EQ(second.instrument(), 2);
+  EXPECT_TRUE(second.bidLevels().empty());
+  EXPECT_TRUE(second.askLevels()[0] == L2PriceLevel(101, 10));
+  EXPECT_EQ(first.bytes() + second.bytes(), buffer.size());
+}
+
+TEST(SnapshotViewTest, truncatedBufferTest) {
+  std::vector<std::byte> buffer;
+  encodeSnapshot({{{99, 30}, {98, 10}}, {{101, 10}}}, buffer);
+  // Every truncation of the buffer is detected
+  for (std::size_t size = 0; size < buffer.size(); ++size) {
+    EXPECT_FALSE(SnapshotView(Span<const std::byte>(buffer.data(), size)).valid());
+  }
+  EXPECT_FALSE(SnapshotView().valid());
+}
+
+}
\ No newline at end of file
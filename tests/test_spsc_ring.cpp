@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "spsc_ring.h"
+
+namespace {
+using namespace OrderBook;
+
+TEST(SpscRingTest, pushPopTest) {
+  SpscRing<int> ring(4);
+  EXPECT_EQ(ring.capacity(), 4);
+  EXPECT_TRUE(ring.empty());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(ring.tryPush(i));
+  }
+  // The ring is full
+  EXPECT_FALSE(ring.tryPush(4));
+  EXPECT_EQ(ring.tryPop(), 0);
+  EXPECT_TRUE(ring.tryPush(4));
+  for (int i = 1; i <= 4; ++i) {
+    EXPECT_EQ(ring.tryPop(), i);
+  }
+  EXPECT_FALSE(ring.tryPop().has_value());
+}
+
+TEST(SpscRingTest, twoThreadsTest) {
+  // The consumer sees all the values in the order they are pushed
+  constexpr int kNumValues = 100000;
+  SpscRing<int> ring(64);
+  std::thread producer([&ring] {
+    for (int i = 0; i < kNumValues; ++i) {
+      while (!ring.tryPush(i)) std::this_thread::yield();
+    }
+  });
+  int expected = 0;
+  while (expected < kNumValues) {
+    if (auto value = ring.tryPop()) {
+      ASSERT_EQ(*value, expected);
+      ++expected;
+    }
+  }
+  producer.join();
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingTest, consumeBatchTest) {
+  SpscRing<int> ring(8);
+  for (int i = 0; i < 5; ++i) ring.tryPush(i);
+  std::vector<int> values;
+  EXPECT_EQ(ring.consume([&values](int value) { values.push_back(value); }, 3), 3);
+  EXPECT_EQ(ring.consume([&values](int value) { values.push_back(value); }, 3), 2);
+  EXPECT_EQ(ring.consume([&values](int value) { values.push_back(value); }, 3), 0);
+  EXPECT_EQ(values, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(SpscRingTest, blockingModeTest) {
+  // The consumer sleeps on the empty ring and is woken up by the producer and by close
+  constexpr int kNumValues = 10000;
+  SpscRing<int> ring(16, WaitMode::BLOCKING);
+  std::thread producer([&ring] {
+    for (int i = 0; i < kNumValues; ++i) {
+      while (!ring.tryPush(i)) std::this_thread::yield();
+      if (i % 1000 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ring.close();
+  });
+  int expected = 0;
+  while (true) {
+    bool closed = ring.closed();
+    auto count = ring.consume([&expected](int value) { EXPECT_EQ(value, expected++); }, 8);
+    if (count > 0) continue;
+    if (closed) break;
+    ring.waitForData();
+  }
+  producer.join();
+  EXPECT_EQ(expected, kNumValues);
+}
+
+}
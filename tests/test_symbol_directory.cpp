@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "symbol_directory.h"
+
+namespace {
+using namespace OrderBook;
+
+TEST(SymbolDirectoryTest, lookupTest) {
+  SymbolDirectory directory({"AAPL", "MSFT", "AAPL", "GOOG"});
+  // The duplicated symbol keeps its first id
+  EXPECT_EQ(directory.size(), 3);
+  EXPECT_EQ(directory.find("AAPL"), 0);
+  EXPECT_EQ(directory.find("MSFT"), 1);
+  EXPECT_EQ(directory.find("GOOG"), 2);
+  EXPECT_EQ(directory.find("AMZN"), kUnknownInstrument);
+  EXPECT_EQ(directory.symbol(2), "GOOG");
+
+  SymbolDirectory empty_directory({});
+  EXPECT_EQ(empty_directory.find("AAPL"), kUnknownInstrument);
+}
+
+TEST(SymbolDirectoryTest, manySymbolsTest) {
+  std::vector<std::string> symbols;
+  for (int i = 0; i < 8000; ++i) {
+    symbols.push_back("SYM" + std::to_string(i));
+  }
+  SymbolDirectory directory(symbols);
+  EXPECT_EQ(directory.size(), 8000);
+  for (InstrumentId id = 0; id < symbols.size(); ++id) {
+    ASSERT_EQ(directory.find(symbols[id]), id);
+  }
+  EXPECT_EQ(directory.find("SYM8000"), kUnknownInstrument);
+}
+
+}
\ No newline at end of file